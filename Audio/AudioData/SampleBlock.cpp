@@ -42,8 +42,8 @@ MaxMinRMS SampleBlock::GetMaxMinRMS() {
 
 }
 
-SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src, SampleFormat srcFormat, size_t numSamples) {
-    auto result = DoCreate(src, srcFormat, numSamples);
+SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold) {
+    auto result = DoCreate(src, srcFormat, numSamples, silenceThreshold);
     if (!result);
         //Throw Error Here
     return result;
@@ -56,6 +56,13 @@ SampleBlockPtr SampleBlockFactory::CreateFromID(SampleFormat srcFormat, SampleBl
     return result;
 }
 
+SampleBlockPtr SampleBlockFactory::CreateDeferred(SampleFormat srcFormat, SampleBlockID srcBlockID, size_t numSamples) {
+    auto result = DoCreateDeferred(srcFormat, srcBlockID, numSamples);
+    if (!result)
+        wxASSERT(false);
+    return result;
+}
+
 SampleBlockPtr SampleBlockFactory::CreateSilent(size_t nSamples, SampleFormat srcFormat) {
     auto result = DoCreateSilent(nSamples, srcFormat);
     if (!result)
@@ -63,3 +70,9 @@ SampleBlockPtr SampleBlockFactory::CreateSilent(size_t nSamples, SampleFormat sr
     return result;
 }
 
+SampleBlockReaderPtr SampleBlockFactory::CreateReader() {
+    auto result = DoCreateReader();
+    if (!result)
+        wxASSERT(false);
+    return result;
+}
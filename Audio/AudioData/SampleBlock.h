@@ -42,6 +42,8 @@ public:
 
 
      virtual BlockSampleView GetFloatSampleView() = 0;
+     //true while someone is holding the view, reads are served from it instead of storage then
+     virtual bool hasSampleView() = 0;
      //for section of block
      MaxMinRMS GetMaxMinRMS(size_t start, size_t len);
      //for entire block
@@ -57,17 +59,44 @@ protected:
 
 using SampleBlockPtr = std::shared_ptr<SampleBlock>;
 
+//Reads samples out of blocks one after the other, keeping whatever the storage needs open
+//between reads so the next block doesnt pay the full lookup again
+class SampleBlockReader {
+public:
+     virtual ~SampleBlockReader() = default;
+
+     virtual size_t Read(SampleBlock& block, samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) = 0;
+     //let go of anything held open
+     virtual void Close() = 0;
+
+     //reads this reader served from a held sample view vs from storage
+     size_t getCachedReads() const {return mCachedReads;}
+     size_t getStorageReads() const {return mStorageReads;}
+
+protected:
+     size_t mCachedReads = 0;
+     size_t mStorageReads = 0;
+};
+
+using SampleBlockReaderPtr = std::unique_ptr<SampleBlockReader>;
+
 class SampleBlockFactory {
 public:
      virtual ~SampleBlockFactory() = default;
 
-     SampleBlockPtr Create(constSamplePtr src, SampleFormat srcFormat, size_t numSamples);
+     //samples that never go past silenceThreshold (linear) come back as a silent block, negative keeps everything
+     SampleBlockPtr Create(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold = -1.0f);
      SampleBlockPtr CreateFromID(SampleFormat srcFormat, SampleBlockID srcBlockID);
+     //Doesnt touch storage, block metadata gets loaded the first time its needed
+     SampleBlockPtr CreateDeferred(SampleFormat srcFormat, SampleBlockID srcBlockID, size_t numSamples);
      SampleBlockPtr CreateSilent(size_t nSamples, SampleFormat srcFormat);
+     SampleBlockReaderPtr CreateReader();
 protected:
-     virtual SampleBlockPtr DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples) = 0;
+     virtual SampleBlockPtr DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold) = 0;
      virtual SampleBlockPtr DoCreateID(SampleFormat srcFormat, SampleBlockID srcBlockID) = 0;
+     virtual SampleBlockPtr DoCreateDeferred(SampleFormat srcFormat, SampleBlockID srcBlockID, size_t numSamples) = 0;
      virtual SampleBlockPtr DoCreateSilent(size_t nSamples, SampleFormat srcFormat) = 0;
+     virtual SampleBlockReaderPtr DoCreateReader() = 0;
 };
 
 
@@ -9,6 +9,8 @@
 #include "Sequence.h"
 
 #include <cassert>
+#include <cfloat>
+#include <cmath>
 #include <iostream>
 #include <wx/cpp.h>
 #include <wx/debug.h>
@@ -17,6 +19,7 @@
 #include "../Dither.h"
 
 size_t Sequence::sHardDiskBlockSize = 1048576;
+float Sequence::sSilenceThreshold = -1.0f;
 
 inline bool Overflows(size_t numSampels) {
     return numSampels > wxLL(9223372036854775807);
@@ -105,23 +108,25 @@ void Sequence::DoAppend(constSamplePtr src, SampleFormat srcFormat, size_t len)
     SampleBuffer buffer(bufferSize, dstFormat);
     bool replaceLast = false;
 
-    std::vector<float> test;
-    test.resize(len);
-
-    CopySamples(src, floatSample, (samplePtr)test.data(), floatSample, len, none);
-
     //If the last block isnt already full fill it
     if (numBlocks > 0 &&
         (length = (pLastBlock = &mBlocks.back())->sb->getSampleCount()) < mMinSamples) {
         const SeqBlock &lastBlock = *pLastBlock;
         const auto addLen = std::min(mMaxSamples-length, len);
+        const auto newLastBlockLen = length + addLen;
 
         read(buffer.ptr(), dstFormat, lastBlock, 0, length);
 
         CopySamples(src, srcFormat, buffer.ptr()+length*SAMPLE_SIZE(dstFormat), dstFormat, addLen, DitherType::none);
 
-        const auto newLastBlockLen = length + addLen;
-        SampleBlockPtr pBlock = factory->Create(buffer.ptr(), dstFormat, newLastBlockLen);
+        //only silence onto silence can stay silent
+        const bool wasSilent = lastBlock.sb->isSilent();
+        SampleBlockPtr pBlock = factory->Create(buffer.ptr(), dstFormat, newLastBlockLen, wasSilent ? sSilenceThreshold : -1.0f);
+        if (pBlock->isSilent()) {
+            mSilentSamples += addLen;
+        } else if (wasSilent) {
+            mSilentSamples -= length;
+        }
         SeqBlock newLastBlock(pBlock, lastBlock.start);
 
         newBlocks.push_back(newLastBlock);
@@ -139,12 +144,17 @@ void Sequence::DoAppend(constSamplePtr src, SampleFormat srcFormat, size_t len)
         const auto addedSamples = std::min(idealBlockSize, len);
         SampleBlockPtr pBlock;
 
+        //gated or unused inputs just get a reference to a silent block instead of a blob full of near zeros,
+        //the block decides from the min/max of its own summary pass
         if (srcFormat == dstFormat) {
-            pBlock = factory->Create(src, dstFormat, addedSamples);
+            pBlock = factory->Create(src, dstFormat, addedSamples, sSilenceThreshold);
         } else {
             CopySamples(src,srcFormat, buffer.ptr(), dstFormat, addedSamples, DitherType::none);
 
-            pBlock = factory->Create(buffer.ptr(), dstFormat, addedSamples);
+            pBlock = factory->Create(buffer.ptr(), dstFormat, addedSamples, sSilenceThreshold);
+        }
+        if (pBlock->isSilent()) {
+            mSilentSamples += addedSamples;
         }
 
         newBlocks.push_back(SeqBlock(pBlock, newNumSamples));
@@ -242,6 +252,92 @@ bool Sequence::getSamples(samplePtr dst, SampleFormat dstFormat, sampleCount sta
     return DoGet(b, dst, dstFormat, start, nSamples) && !bOutOfBounds;
 }
 
+std::vector<MaxMinRMS> Sequence::GetSummary(sampleCount start, sampleCount len, size_t bins) {
+    std::vector<MaxMinRMS> summary(bins);
+
+    const sampleCount end = std::min(start + len, mSampleCount);
+    start = std::max<sampleCount>(start, 0);
+    if (bins == 0 || start >= end || mBlocks.empty()) {
+        return summary;
+    }
+
+    const double binLen = (end - start).as_double()/bins;
+    int b = FindBlock(start);
+
+    for (size_t bin = 0; bin < bins; ++bin) {
+        const sampleCount binStart = start + sampleCount(bin*binLen);
+        const sampleCount binEnd = (bin+1 == bins) ? end : start + sampleCount((bin+1)*binLen);
+
+        float min = FLT_MAX;
+        float max = -FLT_MAX;
+        double sumSq = 0;
+
+        //bins go forward so the block search only happens once, after that its just stepping along
+        for (sampleCount pos = binStart; pos < binEnd;) {
+            while (pos >= mBlocks[b].start + mBlocks[b].sb->getSampleCount()) {
+                ++b;
+            }
+            const SeqBlock& block = mBlocks[b];
+            const size_t blockLen = block.sb->getSampleCount();
+            const size_t offset = (pos - block.start).as_size_t();
+            const size_t count = std::min<size_t>(blockLen - offset, (binEnd - pos).as_size_t());
+
+            auto result = (offset == 0 && count == blockLen) ? block.sb->GetMaxMinRMS() : block.sb->GetMaxMinRMS(offset, count);
+            min = std::min(min, result.min);
+            max = std::max(max, result.max);
+            sumSq += double(result.RMS)*result.RMS*count;
+
+            pos += count;
+        }
+
+        const double binSamples = (binEnd - binStart).as_double();
+        summary[bin] = {max, min, binSamples > 0 ? (float)sqrt(sumSq/binSamples) : 0.0f};
+    }
+
+    return summary;
+}
+
+sampleCount Sequence::AlignToSummary(sampleCount pos, bool up) {
+    if (mBlocks.empty() || pos <= 0 || pos >= mSampleCount) {
+        return std::clamp<sampleCount>(pos, 0, mSampleCount);
+    }
+
+    const SeqBlock& block = mBlocks[FindBlock(pos)];
+    const size_t offset = (pos - block.start).as_size_t();
+    size_t aligned = offset/256*256;
+    if (up && aligned != offset) {
+        aligned = std::min(aligned + 256, block.sb->getSampleCount());
+    }
+
+    return block.start + aligned;
+}
+
+void Sequence::getBlocksFrom(sampleCount pos, bool backwards, size_t count, std::vector<SeqBlock> &blocks) {
+    if (mBlocks.empty() || count == 0) {
+        return;
+    }
+
+    //going backwards from past the end still has blocks to play
+    if (pos >= mSampleCount) {
+        if (!backwards) {
+            return;
+        }
+        pos = mSampleCount - 1;
+    }
+    if (pos < 0) {
+        if (backwards) {
+            return;
+        }
+        pos = 0;
+    }
+
+    int b = FindBlock(pos);
+    for (size_t i = 0; i < count && b >= 0 && b < (int)mBlocks.size(); ++i) {
+        blocks.push_back(mBlocks[b]);
+        b += backwards ? -1 : 1;
+    }
+}
+
 bool Sequence::DoGet(int b, samplePtr dst, SampleFormat dstFormat, sampleCount start, size_t len) {
     bool result = true;
     while (len) {
@@ -277,7 +373,7 @@ int Sequence::FindBlock(sampleCount pos) {
     //Perform dictionary search
     while (true) {
         const double frac = (pos-lowSamples).as_double()/(hiSamples-lowSamples).as_double();
-        guess = std::min(hi-1, size_t(frac*(hi-low)));
+        guess = std::min(hi-1, low + size_t(frac*(hi-low)));
         const SeqBlock &block = mBlocks[guess];
 
         if (pos < block.start) {
@@ -310,6 +406,124 @@ void Sequence::loadBlockFromID(int id){
 
     mBlocks.push_back(SeqBlock(newBlock, mSampleCount));
     mSampleCount+= newBlock->getSampleCount();
+    if (newBlock->isSilent()) {
+        mSilentSamples += newBlock->getSampleCount();
+    }
+
+    mBlockCount.store(mBlocks.size(), std::memory_order_relaxed);
+}
+
+void Sequence::loadBlockFromID(int id, size_t numSamples) {
+    auto newBlock = mpFactory->CreateDeferred(floatSample, id, numSamples);
+
+    mBlocks.push_back(SeqBlock(newBlock, mSampleCount));
+    mSampleCount+= numSamples;
+    if (id <= 0) {
+        mSilentSamples += numSamples;
+    }
 
     mBlockCount.store(mBlocks.size(), std::memory_order_relaxed);
 }
+
+
+//SequenceReader
+
+SequenceReader::SequenceReader(Sequence &sequence)
+    :mSequence(sequence), mReader(sequence.mpFactory->CreateReader()) {
+}
+
+int SequenceReader::LocateBlock(sampleCount pos) {
+    const auto &blocks = mSequence.mBlocks;
+    const int numBlocks = mSequence.getBlockCount();
+
+    if (mBlock >= 0 && mBlock < numBlocks) {
+        //playing forwards the last read leaves us right here
+        const SeqBlock &block = blocks[mBlock];
+        if (pos >= block.start && pos < block.start + block.sb->getSampleCount()) {
+            return mBlock;
+        }
+        //playing backwards it ends up one block behind
+        if (mBlock > 0 && pos < block.start && pos >= blocks[mBlock-1].start) {
+            return --mBlock;
+        }
+    }
+
+    mBlock = mSequence.FindBlock(pos);
+    return mBlock;
+}
+
+bool SequenceReader::Read(samplePtr dst, SampleFormat dstFormat, sampleCount start, size_t nSamples) {
+    if (start != mPos) {
+        Seek(start);
+    }
+    return Read(dst, dstFormat, nSamples);
+}
+
+bool SequenceReader::Read(samplePtr dst, SampleFormat dstFormat, size_t nSamples) {
+    const auto sampleSize = SAMPLE_SIZE(dstFormat);
+    const auto totalSamples = mSequence.GetSampleCount();
+    bool bOutOfBounds = false;
+
+    sampleCount start = mPos;
+    mPos += nSamples;
+
+    if (start < 0) {
+        const auto fillLen = LimitSampleBufferSize(nSamples, -start);
+        ClearSamples(dst, dstFormat, 0, fillLen);
+        //entire request OOB
+        if (nSamples == fillLen) {
+            return false;
+        }
+        start = 0;
+        dst += fillLen*sampleSize;
+        nSamples -= fillLen;
+        bOutOfBounds = true;
+    }
+    if (start >= totalSamples) {
+        ClearSamples(dst, dstFormat, 0, nSamples);
+        return false;
+    }
+
+    if (start+nSamples > totalSamples) {
+        const auto excess = (start + nSamples - totalSamples).as_size_t();
+        ClearSamples(dst, dstFormat, nSamples-excess, excess);
+
+        nSamples-=excess;
+        bOutOfBounds = true;
+    }
+
+    int b = LocateBlock(start);
+    bool result = true;
+
+    while (nSamples) {
+        const SeqBlock &block = mSequence.mBlocks[b];
+        const size_t blockLen = block.sb->getSampleCount();
+
+        const size_t bStart = (start-block.start).as_size_t();
+        const auto bLen = std::min(nSamples, blockLen-bStart);
+
+        if (mReader->Read(*block.sb, dst, dstFormat, bStart, bLen) != bLen) {
+            //EXPECTED A DIFFERENT AMOUNT OF SAMPLES
+            wxASSERT(false);
+            result = false;
+        }
+
+        nSamples -= bLen;
+        dst += bLen*sampleSize;
+        start += bLen;
+
+        //used the block up so the next read starts in the one after
+        if (bStart + bLen == blockLen) {
+            b++;
+        }
+    }
+
+    mBlock = b;
+
+    return result && !bOutOfBounds;
+}
+
+void SequenceReader::Close() {
+    mReader->Close();
+    mBlock = -1;
+}
@@ -10,6 +10,7 @@
 #define SEQUENCE_H
 #include <atomic>
 #include <deque>
+#include <vector>
 
 #include "SampleBlock.h"
 #include "../SampleCount.h"
@@ -32,6 +33,7 @@ using BlockPtrArray = std::deque<BlockArray*>;
 using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 
 class Sequence {
+    friend class SequenceReader;
 
     SampleBlockFactoryPtr mpFactory;
     SampleFormats mSampleFormats;
@@ -47,8 +49,14 @@ class Sequence {
     size_t mMinSamples = 0;
     size_t mMaxSamples = 0;
 
+    //samples held in silent blocks, nothing was written to disk for these
+    std::atomic<size_t> mSilentSamples {0};
+
     // STATIC MEMBERS
     static size_t sHardDiskBlockSize;
+    //blocks that never go past this (linear) get stored as silent blocks, negative (the default) turns it off.
+    //its lossy so its up to the show to turn it on
+    static float sSilenceThreshold;
 
 public:
 
@@ -62,15 +70,30 @@ public:
     size_t GetMinBlockSize() const {return mMinSamples;}
 
     int FindBlock(sampleCount pos);
+    //the block holding pos and the count-1 after it (or before it when going backwards)
+    void getBlocksFrom(sampleCount pos, bool backwards, size_t count, std::vector<SeqBlock>& blocks);
     bool getSamples(samplePtr dst, SampleFormat dstFormat, sampleCount start, size_t nSamples);
 
+    //min/max/rms of [start, start+len) split into bins even pieces (one per pixel for drawing). Whole blocks use
+    //their totals and partial ones their summaries, samples only get read for the bits under 256 at the edges
+    std::vector<MaxMinRMS> GetSummary(sampleCount start, sampleCount len, size_t bins);
+    //start of the 256 summary frame pos is in, or with up the end of it. The frames start over at every block,
+    //so a range between two aligned positions never needs samples read to be summarised
+    sampleCount AlignToSummary(sampleCount pos, bool up = false);
+
     size_t GetAppendBufferLen() const {return mAppendBufferLen;}
     sampleCount GetSampleCount() const {return mSampleCount;}
+    size_t GetSilentSampleCount() const {return mSilentSamples.load(std::memory_order_relaxed);}
+    //disk space that the silent blocks would have taken up
+    size_t GetSilentBytes() const {return GetSilentSampleCount()*SAMPLE_SIZE(mSampleFormats.getStored());}
 
     size_t getBlockCount() const {return mBlockCount.load();}
     size_t getBlockIDAtIndex(int index) const {return mBlocks[index].sb->getBlockID();}
+    sampleCount getBlockStartAtIndex(int index) const {return mBlocks[index].start;}
 
     void loadBlockFromID(int id);
+    //lazy version, the block wont touch the db until its actually used
+    void loadBlockFromID(int id, size_t numSamples);
 
 private:
     void AppendBlocks(BlockArray& additionalBlocks, bool replaceLast, sampleCount numSamples);
@@ -80,10 +103,45 @@ private:
 
 public:
     static void setHardDiskBlockSize(size_t bytes) {sHardDiskBlockSize = bytes;}
+    static void setSilenceThreshold(float threshold) {sSilenceThreshold = threshold;}
+    static float getSilenceThreshold() {return sSilenceThreshold;}
 
     static bool read(samplePtr buffer, SampleFormat format, const SeqBlock& seqBlock, size_t blockRelativeStart, size_t len);
 };
 
+//Cursor for streaming through a sequence. Remembers which block it is in so reads that follow
+//on from the last one dont search for it again, and keeps the storage open from block to block
+class SequenceReader {
+    Sequence& mSequence;
+    SampleBlockReaderPtr mReader;
+
+    //block holding mPos, -1 when it has to be looked up again
+    int mBlock = -1;
+    sampleCount mPos = 0;
+
+public:
+    explicit SequenceReader(Sequence& sequence);
+
+    void Seek(sampleCount pos) {mPos = pos;}
+    sampleCount Tell() const {return mPos;}
+
+    //reads from the current position and moves past what was read, anything out of range is silence
+    bool Read(samplePtr dst, SampleFormat dstFormat, size_t nSamples);
+    //seeks to start first, only ends up searching if start isnt near the last read
+    bool Read(samplePtr dst, SampleFormat dstFormat, sampleCount start, size_t nSamples);
+
+    //closes whatever is held open, the next read picks back up where it left off
+    void Close();
+    //closes the storage but remembers the block, for readers that stop and start a lot (playback)
+    void ReleaseStorage() {mReader->Close();}
+
+    size_t GetCachedReads() const {return mReader->getCachedReads();}
+    size_t GetStorageReads() const {return mReader->getStorageReads();}
+
+private:
+    int LocateBlock(sampleCount pos);
+};
+
 
 
 #endif //SEQUENCE_H
@@ -12,12 +12,19 @@
 #include <cfloat>
 #include <iostream>
 
+#include "SummaryWorker.h"
 #include "../Dither.h"
+#include "../SampleKernels.h"
 #include "../SampleCount.h"
 #include "../IO/AudioIO.h"
 
 
 std::map<SampleBlockID, std::shared_ptr<SqliteSampleBlock>> SqliteSampleBlockFactory::sSilentBlocks;
+std::mutex SqliteSampleBlockFactory::sSilentBlocksMutex;
+
+std::atomic<bool> SqliteSampleBlock::sDeferSummaries {true};
+size_t SqliteSampleBlock::sMaxPendingBytes = 256*1024*1024;
+std::atomic<size_t> SqliteSampleBlock::sPendingBytes {0};
 
 //FACTORY FUNCTIONS
 SqliteSampleBlockFactory::SqliteSampleBlockFactory() {
@@ -29,10 +36,12 @@ DBConnection *SqliteSampleBlockFactory::DBConn() {
     return mDB.get();
 }
 
-SampleBlockPtr SqliteSampleBlockFactory::DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples) {
+SampleBlockPtr SqliteSampleBlockFactory::DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold) {
     auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
 
-    sb->SetSamples(src, srcFormat, numSamples);
+    if (!sb->SetSamples(src, srcFormat, numSamples, silenceThreshold)) {
+        return DoCreateSilent(numSamples, srcFormat);
+    }
 
     if (sb.get()) {
         mAllBlocks[sb->getBlockID()] = sb;
@@ -40,6 +49,10 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(constSamplePtr src, SampleForm
         wxASSERT(false);
     }
 
+    if (sb->summariesPending()) {
+        SummaryWorker::Get().Add(sb);
+    }
+
     return sb;
 }
 
@@ -63,8 +76,38 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateID(SampleFormat srcFormat, Samp
 
     return sb;
 }
+
+SampleBlockPtr SqliteSampleBlockFactory::DoCreateDeferred(SampleFormat srcFormat, SampleBlockID srcBlockID, size_t numSamples) {
+    if (srcBlockID <=0) {
+        return DoCreateSilent(-srcBlockID, srcFormat);
+    }
+
+    auto &wp = mAllBlocks[srcBlockID];
+    if (auto block = wp.lock()) {
+        return block;
+    }
+
+    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
+
+    wp = sb;
+
+    //The sample count comes from the saved track offsets, everything else is read on first use
+    sb->mBlockID = srcBlockID;
+    sb->mSampleFormat = srcFormat;
+    sb->mSampleCount = numSamples;
+    sb->mSampleBytes = numSamples*SAMPLE_SIZE(srcFormat);
+    sb->mValid = false;
+
+    return sb;
+}
+
+SampleBlockReaderPtr SqliteSampleBlockFactory::DoCreateReader() {
+    return std::make_unique<SqliteSampleBlockReader>(mDB);
+}
+
 SampleBlockPtr SqliteSampleBlockFactory::DoCreateSilent(size_t nSamples, SampleFormat srcFormat) {
     SampleBlockID id = -nSamples;
+    std::lock_guard<std::mutex> lock(sSilentBlocksMutex);
     auto &sb = sSilentBlocks[id];
     if (!sb) {
         sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
@@ -91,22 +134,117 @@ SqliteSampleBlock::SqliteSampleBlock(const std::shared_ptr<SqliteSampleBlockFact
 }
 
 SqliteSampleBlock::~SqliteSampleBlock() {
+    if (mPendingSamples) {
+        sPendingBytes -= mSampleBytes;
+    }
     mSamples.release();
     mSummary64k.release();
     mSummary256.release();
 }
 
-void SqliteSampleBlock::SetSamples(constSamplePtr src, SampleFormat srcFormat, size_t numSamples) {
+bool SqliteSampleBlock::SetSamples(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold) {
 
     auto sizes = SetSizes(numSamples, srcFormat);
 
-    mSamples.Reinit(mSampleBytes);
+    //the worker fills the summaries in after the samples are saved, unless theyre needed now to tell if its silent
+    if (sDeferSummaries && silenceThreshold < 0) {
+        mSamples.Reinit(mSampleBytes);
+        memcpy(mSamples.get(), src, numSamples*SAMPLE_SIZE(srcFormat));
 
-    memcpy(mSamples.get(), src, numSamples*SAMPLE_SIZE(srcFormat));
+        mSummariesPending = true;
+        Commit(sizes);
+        return true;
+    }
+
+    Floats floatSamples;
+    const float* samples = (const float*)src;
+    if (mSampleFormat != floatSample) {
+        floatSamples.Reinit(mSampleCount);
+        SamplesToFloat(src, mSampleFormat, floatSamples.get(), mSampleCount);
+        samples = floatSamples.get();
+    }
 
-    CalcSummaries(sizes);
+    CalcSummaries(sizes, samples);
+
+    if (silenceThreshold >= 0 && mSumMax <= silenceThreshold && mSumMin >= -silenceThreshold) {
+        return false;
+    }
+
+    mSamples.Reinit(mSampleBytes);
+    memcpy(mSamples.get(), src, numSamples*SAMPLE_SIZE(srcFormat));
 
     Commit(sizes);
+    return true;
+}
+
+bool SqliteSampleBlock::FillSummaries() {
+    if (!mSummariesPending) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mSummaryMutex);
+    if (!mSummariesPending) {
+        return true;
+    }
+
+    auto sizes = SetSizes(mSampleCount, mSampleFormat);
+
+    Floats floatSamples;
+    const float* samples = (const float*)mPendingSamples.get();
+    if (!mPendingSamples || mSampleFormat != floatSample) {
+        floatSamples.Reinit(mSampleCount);
+        if (mPendingSamples) {
+            SamplesToFloat(mPendingSamples.get(), mSampleFormat, floatSamples.get(), mSampleCount);
+        } else if (GetSamples((samplePtr)floatSamples.get(), floatSample, 0, mSampleCount) != mSampleCount) {
+            //the row cant be read (yet), summaries of whatever is in the buffer would be wrong so try again later
+            return false;
+        }
+        samples = floatSamples.get();
+    }
+
+    CalcSummaries(sizes, samples);
+
+    //in their own table, updating sampleBlocks would write the whole row out again samples and all
+    auto writeLock = Conn()->lockWrites();
+    auto* stmt = Conn()->Prepare(DBConnection::InsertSampleSummaries,
+        "INSERT OR REPLACE INTO sampleSummaries (blockID, summin, summax, sumrms, summary256, summary64k)"
+        "                        VALUES(?1, ?2, ?3, ?4, ?5, ?6);");
+
+    if (sqlite3_bind_int64(stmt, 1, mBlockID) ||
+        sqlite3_bind_double(stmt, 2, mSumMin) ||
+        sqlite3_bind_double(stmt, 3, mSumMax) ||
+        sqlite3_bind_double(stmt, 4, mSumRMS) ||
+        sqlite3_bind_blob(stmt, 5, mSummary256.get(), sizes.first, SQLITE_STATIC) ||
+        sqlite3_bind_blob(stmt, 6, mSummary64k.get(), sizes.second, SQLITE_STATIC))
+        {
+        //BINDING FAIlED (replace with log)
+        wxASSERT(false);
+    }
+
+    bool saved = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!saved) {
+        //STEP FAILED (replace with log)
+        wxASSERT(false);
+    }
+
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    mSummary256.reset();
+    mSummary64k.reset();
+
+    if (!saved) {
+        return false;
+    }
+    Conn()->noteBytesWritten(sizes.first + sizes.second);
+
+    if (mPendingSamples) {
+        sPendingBytes -= mSampleBytes;
+        mPendingSamples.reset();
+    }
+
+    mSummariesPending = false;
+    return true;
 }
 
 void SqliteSampleBlock::load(SampleBlockID id) {
@@ -114,8 +252,9 @@ void SqliteSampleBlock::load(SampleBlockID id) {
     assert(id >0);
 
     auto* stmt = Conn()->Prepare(DBConnection::LoadSampleBlock,
-        "SELECT sampleformat, summin, summax, sumrms, length(samples)"
-        "    FROM sampleBlocks WHERE blockID = ?1;");
+        "SELECT b.sampleformat, COALESCE(s.summin, b.summin), COALESCE(s.summax, b.summax), COALESCE(s.sumrms, b.sumrms),"
+        "    length(b.samples) FROM sampleBlocks b LEFT JOIN sampleSummaries s ON s.blockID = b.blockID"
+        "    WHERE b.blockID = ?1;");
 
     //Bind blockID
     if (sqlite3_bind_int(stmt, 1, id)) {
@@ -144,14 +283,27 @@ void SqliteSampleBlock::load(SampleBlockID id) {
     mValid = true;
 }
 
+void SqliteSampleBlock::EnsureLoaded() {
+    if (mValid || isSilent()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mLoadMutex);
+    if (!mValid) {
+        load(mBlockID);
+    }
+}
+
 void SqliteSampleBlock::Commit(Sizes sizes) {
     const auto summary256Bytes = sizes.first;
     const auto summary64kBytes = sizes.second;
 
+    auto writeLock = Conn()->lockWrites();
+    //RETURNING, last_insert_rowid is per connection so its wrong when more than one thread is inserting
     auto* stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
         "INSERT INTO sampleBlocks (sampleformat, summin, summax, sumrms,"
         "                              samples, summary256, summary64k)"
-        "                              VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7);");
+        "                              VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7) RETURNING blockID;");
 
 
     //INPUT VALUES
@@ -166,13 +318,21 @@ void SqliteSampleBlock::Commit(Sizes sizes) {
         //BINDING FAIlED (replace with log)
         wxASSERT(false);
     }
-    //Perform step
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
+    //Perform step, the insert is all done by the time the first row comes back
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
         //STEP FAILED (replace with log)
         wxASSERT(false);
+        Conn()->noteWriteFailed();
     }
 
-    mBlockID = sqlite3_last_insert_rowid(DB());
+    mBlockID = sqlite3_column_int64(stmt, 0);
+    Conn()->noteBytesWritten(mSampleBytes + (mSummariesPending ? 0 : summary256Bytes + summary64kBytes));
+
+    //the worker works the summaries out from these instead of reading the row back
+    if (mSummariesPending && sPendingBytes.load() + mSampleBytes <= sMaxPendingBytes) {
+        sPendingBytes += mSampleBytes;
+        mPendingSamples = std::move(mSamples);
+    }
 
     mSamples.reset();
     mSummary64k.reset();
@@ -190,6 +350,7 @@ void SqliteSampleBlock::Commit(Sizes sizes) {
 }
 
 void SqliteSampleBlock::Delete() {
+    auto writeLock = Conn()->lockWrites();
     auto* stmt = Conn()->Prepare(DBConnection::DeleteSampleBlock,
         "DELETE FROM sampleblocks WHERE blockID = ?1;");
 
@@ -208,113 +369,94 @@ void SqliteSampleBlock::Delete() {
     //Reset Stmt for future use
     sqlite3_clear_bindings(stmt);
     sqlite3_reset(stmt);
-}
 
-bool SqliteSampleBlock::CalcSummaries(Sizes sizes) {
-    const auto summary256Bytes = sizes.first;
-    const auto summary64kBytes = sizes.second;
+    stmt = Conn()->Prepare(DBConnection::DeleteSampleSummaries,
+        "DELETE FROM sampleSummaries WHERE blockID = ?1;");
 
-    float* samples;
+    if (sqlite3_bind_int64(stmt, 1, mBlockID)) {
+        //BINDING FAIlED (replace with log)
+        wxASSERT(false);
+    }
 
-    if (mSampleFormat == floatSample) {
-        samples = (float* )mSamples.get();
-    } else {
-        Floats sampleBuffer;
-        sampleBuffer.Reinit(mSampleBytes);
-        SamplesToFloat(mSamples.get(), mSampleFormat, sampleBuffer.get(), mSampleBytes);
-        samples = sampleBuffer.get();
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        //EXECUTE FAIlED (replace with log)
+        wxASSERT(false);
     }
 
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+}
+
+bool SqliteSampleBlock::CalcSummaries(Sizes sizes, const float* samples) {
+    const auto summary256Bytes = sizes.first;
+    const auto summary64kBytes = sizes.second;
+
     mSummary256.Reinit(summary256Bytes);
     mSummary64k.Reinit(summary64kBytes);
 
     float* summary256 = (float*) mSummary256.get();
     float* summary64k = (float*) mSummary64k.get();
 
-    float max;
-    float min;
-    float sumSq;
+    const size_t frames256 = summary256Bytes/bytesPerFrame;
+    const size_t frames64k = summary64kBytes/bytesPerFrame;
+
+    //sum of squares per 256 frame so the 64k rms can be weighted by how many samples each one really has
+    std::vector<double> sumSquares(frames256, 0.0);
     double totalSquares = 0;
-    double fractions = 0;
 
     int sumLen = (mSampleCount+255)/256;
-    int summaries = 256;
 
     for (int i = 0; i < sumLen; ++i) {
-        min = samples[i*256];
-        max = samples[i*256];
-        sumSq = min*min;
-
-        int jcount = 256;
-        if (jcount > mSampleCount-i*256) {
-            jcount = mSampleCount-i*256;
-            fractions = 1.0-jcount/256;
-        }
-
-        for (int j =i; j<jcount; j++) {
-            float f1 = samples[i*256+j];
-            sumSq += f1*f1;
+        size_t jcount = std::min<size_t>(256, mSampleCount-i*256);
 
-            min = std::min(min, f1);
-            max = std::max(max, f1);
-        }
+        auto result = CalcMinMaxSumSq(samples + i*256, jcount);
 
-        totalSquares += sumSq;
+        sumSquares[i] = result.sumSq;
+        totalSquares += result.sumSq;
 
         //Save min,max,and RMS
-        summary256[i*fields] = min;
-        summary256[i*fields+1] = max;
-        summary256[i*fields+2] = sqrt(sumSq/jcount);
+        summary256[i*fields] = result.min;
+        summary256[i*fields+1] = result.max;
+        summary256[i*fields+2] = sqrt(result.sumSq/jcount);
     }
 
     //We are missing some data so fill remaining summary frames with non harmful data
-    for (int i = sumLen; i<summary256Bytes/bytesPerFrame; i++) {
-        summaries--;
-
+    for (int i = sumLen; i<frames256; i++) {
         summary256[i*fields] = FLT_MAX; //min
         summary256[i*fields+1] = -FLT_MAX; //max
         summary256[i*fields+2] = 0.0f;
     }
 
     //Calc RMS
-    mSumRMS = sqrt(totalSquares/mSampleCount);
+    mSumRMS = mSampleCount ? sqrt(totalSquares/mSampleCount) : 0;
 
-    //Recalc the 64k Size
-    sumLen = (mSampleCount+65535)/65536;
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
 
     //we can use the values previously calculated for the 256 summaries to shrink the loop time.
-    for (int i = 0; i<sumLen; i++) {
-        min = summary256[i*fields*256];
-        max = summary256[i*fields*256+1];
-        sumSq = summary256[i*fields*256+2];
-        sumSq *= sumSq;
-
-        for (int j = 1; j<256; j++) {
-            min = std::min(min, summary256[fields*(i*256+j)]);
-            max = std::max(max, summary256[fields*(i*256+j)+1]);
-
-            float r1 = summary256[fields*(i*256+j)+2];
-            sumSq += r1*r1;
+    for (int i = 0; i<frames64k; i++) {
+        float frameMin = FLT_MAX;
+        float frameMax = -FLT_MAX;
+        double sumSq = 0;
+
+        for (int j = 0; j<256; j++) {
+            frameMin = std::min(frameMin, summary256[fields*(i*256+j)]);
+            frameMax = std::max(frameMax, summary256[fields*(i*256+j)+1]);
+            sumSq += sumSquares[i*256+j];
         }
 
-        float denom = i<sumLen-1 ? 256 : summaries-fractions;
-        float rms = sqrt(sumSq/denom);
+        size_t frameSamples = std::min<size_t>(65536, mSampleCount - std::min<size_t>(mSampleCount, i*65536));
 
-        summary64k[i*fields] = min;
-        summary64k[i*fields+1] = max;
-        summary64k[i*fields+2] = rms;
-    }
-
-    min = summary64k[0];
-    max = summary64k[1];
+        summary64k[i*fields] = frameMin;
+        summary64k[i*fields+1] = frameMax;
+        summary64k[i*fields+2] = frameSamples ? sqrt(sumSq/frameSamples) : 0.0f;
 
-    for (int i = 0; i< sumLen; i++) {
-        min = std::min(summary64k[i*fields], min);
-        max = std::max(summary64k[i*fields+1], max);
+        min = std::min(frameMin, min);
+        max = std::max(frameMax, max);
     }
 
-    mSumMin = min;
-    mSumMax = max;
+    mSumMin = mSampleCount ? min : 0;
+    mSumMax = mSampleCount ? max : 0;
 
     return true;
 }
@@ -356,6 +498,8 @@ bool SqliteSampleBlock::isSilent() {
 bool SqliteSampleBlock::GetSummaries(float *dest, size_t offset, size_t nFrames, DBConnection::statementID id, const char *sql) {
     bool silent = isSilent();
 
+    FillSummaries();
+
     //not Silent
     if (!silent) {
         auto stmt = Conn()->Prepare(id, sql);
@@ -370,11 +514,13 @@ bool SqliteSampleBlock::GetSummaries(float *dest, size_t offset, size_t nFrames,
 }
 
 bool SqliteSampleBlock::GetSummary64k(float *dest, size_t offset, size_t nFrames) {
-    return GetSummaries(dest, offset, nFrames, DBConnection::GetSummary64k, "SELECT summary64k FROM sampleBlocks WHERE blockID = ?1;");
+    return GetSummaries(dest, offset, nFrames, DBConnection::GetSummary64k,
+        "SELECT COALESCE((SELECT summary64k FROM sampleSummaries WHERE blockID = ?1), summary64k) FROM sampleBlocks WHERE blockID = ?1;");
 }
 
 bool SqliteSampleBlock::GetSummary256(float *dest, size_t offset, size_t nFrames) {
-    return GetSummaries(dest, offset, nFrames, DBConnection::GetSummary256, "SELECT summary256 FROM sampleBlocks WHERE blockID = ?1;");
+    return GetSummaries(dest, offset, nFrames, DBConnection::GetSummary256,
+        "SELECT COALESCE((SELECT summary256 FROM sampleSummaries WHERE blockID = ?1), summary256) FROM sampleBlocks WHERE blockID = ?1;");
 }
 
 size_t SqliteSampleBlock::DoGetSamples(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) {
@@ -383,12 +529,43 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest, SampleFormat destFormat,
         return nSamples;
     }
 
+    //if someone (the prefetcher) is holding the decoded block, read from that instead of the db
+    if (ReadCached(dest, destFormat, offset, nSamples)) {
+        return nSamples;
+    }
+
+    return ReadSamples(dest, destFormat, offset, nSamples);
+}
+
+size_t SqliteSampleBlock::ReadCached(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) {
+    BlockSampleView cache;
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        cache = mCache.lock();
+    }
+    if (!cache) {
+        return 0;
+    }
+
+    size_t avail = offset < cache->size() ? std::min(nSamples, cache->size() - offset) : 0;
+
+    CopySamples((constSamplePtr)(cache->data() + offset), floatSample, dest, destFormat, avail, none);
+    if (avail < nSamples) {
+        ClearSamples(dest, destFormat, avail, nSamples - avail);
+    }
+
+    return nSamples;
+}
+
+size_t SqliteSampleBlock::ReadSamples(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) {
     auto* stmt = Conn()->Prepare(DBConnection::statementID::GetSamples, "SELECT samples FROM sampleBlocks WHERE blockID = ?1;");
 
     return GetBlob(stmt, dest, destFormat, mSampleFormat, offset*SAMPLE_SIZE(destFormat), nSamples*SAMPLE_SIZE(destFormat))/SAMPLE_SIZE(destFormat);
 }
 
 MaxMinRMS SqliteSampleBlock::DoGetMaxMinRMS() {
+    EnsureLoaded();
+    FillSummaries();
     return {(float)mSumMax, (float)mSumMin, (float)mSumRMS};
 }
 
@@ -397,50 +574,113 @@ MaxMinRMS SqliteSampleBlock::DoGetMaxMinRMS(size_t start, size_t len) {
         return {};
     }
 
-    float min = FLT_MAX;
-    float max = - FLT_MAX;
-    float sumSQ = 0.0f;
+    EnsureLoaded();
+    if (start >= mSampleCount || len == 0) {
+        return {};
+    }
+    len = std::min(len, mSampleCount - start);
+    const size_t end = start + len;
 
-    if (!mValid) {
-        load(mBlockID);
+    if (start == 0 && end == mSampleCount) {
+        return DoGetMaxMinRMS();
     }
-    if (start < mSampleCount) {
-        len = std::min(len, mSampleCount - start);
 
-        SampleBuffer blockData(len, mSampleFormat);
-        float* samples = (float*)blockData.ptr();
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    double sumSq = 0;
 
-        size_t copied = GetSamples((samplePtr)samples, floatSample, start, len);
+    auto addSamples = [&](size_t from, size_t to) {
+        if (from >= to) {
+            return;
+        }
+        std::vector<float> samples(to - from);
+        GetSamples((samplePtr)samples.data(), floatSample, from, to - from);
+
+        auto result = CalcMinMaxSumSq(samples.data(), samples.size());
+        min = std::min(min, result.min);
+        max = std::max(max, result.max);
+        sumSq += result.sumSq;
+    };
+
+    auto addFrames = [&](size_t from, size_t to, size_t frameSize) {
+        if (from >= to) {
+            return;
+        }
+        const size_t first = from/frameSize;
+        const size_t numFrames = (to + frameSize - 1)/frameSize - first;
+
+        std::vector<float> frames(numFrames*fields);
+        if (frameSize == 256) {
+            GetSummary256(frames.data(), first, numFrames);
+        } else {
+            GetSummary64k(frames.data(), first, numFrames);
+        }
 
-        for (int i = 0; i < copied; ++i, ++samples) {
-            float sample = *samples;
+        for (size_t i = 0; i < numFrames; ++i) {
+            //the last frame only covers whats left of the block
+            const size_t frameStart = (first + i)*frameSize;
+            const size_t frameSamples = std::min(frameSize, mSampleCount - frameStart);
 
-            min = std::min(min,sample);
-            max = std::max(max,sample);
-            sumSQ += sample*sample;
+            min = std::min(min, frames[i*fields]);
+            max = std::max(max, frames[i*fields+1]);
+            sumSq += double(frames[i*fields+2])*frames[i*fields+2]*frameSamples;
         }
+    };
+
+    //a frame that runs off the end of the block is still whole, so the block end counts as aligned
+    auto alignUp = [&](size_t pos, size_t size) {return std::min((pos + size - 1)/size*size, mSampleCount);};
+    auto alignDown = [&](size_t pos, size_t size) {return pos == mSampleCount ? pos : pos/size*size;};
+
+    //raw samples to the first 256 frame, 256 frames to the first 64k frame, then back down the other side
+    const size_t a256 = alignUp(start, 256);
+    const size_t z256 = alignDown(end, 256);
+    if (a256 >= z256) {
+        addSamples(start, end);
+    } else {
+        const size_t a64k = alignUp(a256, 65536);
+        const size_t z64k = alignDown(z256, 65536);
+
+        addSamples(start, a256);
+        if (a64k < z64k) {
+            addFrames(a256, a64k, 256);
+            addFrames(a64k, z64k, 65536);
+            addFrames(z64k, z256, 256);
+        } else {
+            addFrames(a256, z256, 256);
+        }
+        addSamples(z256, end);
     }
-    return {max, min, (float)sqrt(sumSQ/len)};
 
+    return {max, min, (float)sqrt(sumSq/len)};
 }
 
 BlockSampleView SqliteSampleBlock::GetFloatSampleView() {
+    std::lock_guard<std::mutex> lock(mCacheMutex);
 
     auto cache = mCache.lock();
     if (cache) {
         return cache;
     }
 
-    std::lock_guard<std::mutex> lock(mCacheMutex);
-
     const auto newCache = std::make_shared<std::vector<float>>(mSampleCount);
-    const auto cachedSize = GetSamples(reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0, mSampleCount);
+    if (isSilent()) {
+        mCache = newCache;
+        return newCache;
+    }
+
+    //straight from the db, GetSamples would try to take the cache lock again
+    const auto cachedSize = ReadSamples(reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0, mSampleCount);
     assert(cachedSize == mSampleCount);
 
     mCache = newCache;
     return newCache;
 }
 
+bool SqliteSampleBlock::hasSampleView() {
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+    return !mCache.expired();
+}
+
 size_t SqliteSampleBlock::GetBlob(sqlite3_stmt *stmt, void *dest, SampleFormat destFormat, SampleFormat srcFormat, size_t srcOffset, size_t srcBytes) {
     int err;
     assert(!isSilent());
@@ -461,6 +701,7 @@ size_t SqliteSampleBlock::GetBlob(sqlite3_stmt *stmt, void *dest, SampleFormat d
         sqlite3_reset(stmt);
 
         wxASSERT(false);
+        return 0;
     }
 
     samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
@@ -490,10 +731,103 @@ size_t SqliteSampleBlock::GetBlob(sqlite3_stmt *stmt, void *dest, SampleFormat d
 }
 
 
+//SqliteSampleBlockReader
 
+SqliteSampleBlockReader::~SqliteSampleBlockReader() {
+    Close();
+}
 
+void SqliteSampleBlockReader::Close() {
+    if (mBlob) {
+        sqlite3_blob_close(mBlob);
+    }
+    mBlob = nullptr;
+    mBlobDB = nullptr;
+    mBlobID = 0;
+}
 
+bool SqliteSampleBlockReader::OpenBlob(SampleBlockID id) {
+    if (!mConn) {
+        return false;
+    }
 
+    //blobs belong to a connection, so if this thread reads through a different one start over
+    sqlite3* db = mConn->ReadDB();
+    if (db != mBlobDB) {
+        Close();
+    }
 
+    if (mBlob && mBlobID == id) {
+        return true;
+    }
 
+    int err;
+    if (mBlob) {
+        err = sqlite3_blob_reopen(mBlob, id);
+    } else {
+        err = sqlite3_blob_open(db, "main", "sampleBlocks", "samples", id, 0, &mBlob);
+    }
 
+    if (err != SQLITE_OK) {
+        //a failed reopen leaves the handle aborted, it still has to be closed
+        Close();
+        return false;
+    }
+
+    mBlobDB = db;
+    mBlobID = id;
+    return true;
+}
+
+size_t SqliteSampleBlockReader::Read(SampleBlock &block, samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) {
+    auto &sb = static_cast<SqliteSampleBlock&>(block);
+
+    if (sb.isSilent()) {
+        ClearSamples(dest, destFormat, 0, nSamples);
+        return nSamples;
+    }
+
+    if (sb.ReadCached(dest, destFormat, offset, nSamples)) {
+        mCachedReads++;
+        return nSamples;
+    }
+
+    mStorageReads++;
+
+    const auto srcFormat = sb.mSampleFormat;
+    const auto srcSize = SAMPLE_SIZE(srcFormat);
+
+    //rows get rewritten under us (deferred summaries) which expires the handle, so give it one reopen
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!OpenBlob(sb.getBlockID())) {
+            break;
+        }
+
+        const size_t blobSamples = sqlite3_blob_bytes(mBlob)/srcSize;
+        const size_t avail = offset < blobSamples ? std::min(nSamples, blobSamples - offset) : 0;
+
+        int err;
+        if (srcFormat == destFormat) {
+            err = sqlite3_blob_read(mBlob, dest, avail*srcSize, offset*srcSize);
+        } else {
+            SampleBuffer temp(avail, srcFormat);
+            err = sqlite3_blob_read(mBlob, temp.ptr(), avail*srcSize, offset*srcSize);
+            if (err == SQLITE_OK) {
+                CopySamples(temp.ptr(), srcFormat, dest, destFormat, avail, none);
+            }
+        }
+
+        if (err == SQLITE_OK) {
+            if (avail < nSamples) {
+                ClearSamples(dest, destFormat, avail, nSamples - avail);
+            }
+            return nSamples;
+        }
+
+        Close();
+    }
+
+    //couldnt stream it, drop the handle so the statement doesnt read through a stale snapshot
+    Close();
+    return sb.ReadSamples(dest, destFormat, offset, nSamples);
+}
@@ -8,6 +8,7 @@
 
 #ifndef SQLITESAMPLEBLOCK_H
 #define SQLITESAMPLEBLOCK_H
+#include <atomic>
 #include <map>
 #include <sqlite3.h>
 
@@ -17,6 +18,7 @@
 #include "../IO/AudioIO.h"
 
 class SqliteSampleBlockFactory;
+class SqliteSampleBlockReader;
 
 //NumBytes for 256 and 64k summaries
 using Sizes = std::pair<size_t, size_t>;
@@ -25,6 +27,7 @@ class SqliteSampleBlock
     : public SampleBlock {
 
     friend SqliteSampleBlockFactory;
+    friend SqliteSampleBlockReader;
 
     std::weak_ptr<std::vector<float>> mCache;
     std::mutex mCacheMutex;
@@ -32,7 +35,15 @@ class SqliteSampleBlock
     const std::shared_ptr<SqliteSampleBlockFactory> mFactory;
 
     bool mLocked {false};
-    bool mValid {true};
+    //false while the metadata hasnt been read from the db yet (lazy loaded blocks)
+    std::atomic<bool> mValid {true};
+    std::mutex mLoadMutex;
+
+    //set while the summaries are still waiting on the SummaryWorker
+    std::atomic<bool> mSummariesPending {false};
+    std::mutex mSummaryMutex;
+    //the samples kept for the worker so it doesnt read them back, empty once over sMaxPendingBytes
+    ArrayOf<char> mPendingSamples;
 
     SampleBlockID mBlockID{0};
 
@@ -67,27 +78,45 @@ public:
 
     bool GetSummary64k(float *dest, size_t offset, size_t nFrames) override;
     bool GetSummary256(float *dest, size_t offset, size_t nFrames) override;
-    double getSumMax() const {return mSumMax;}
-    double getSumMin() const {return mSumMin;}
-    double getSumRMS() const {return mSumRMS;}
+    double getSumMax() {EnsureLoaded(); FillSummaries(); return mSumMax;}
+    double getSumMin() {EnsureLoaded(); FillSummaries(); return mSumMin;}
+    double getSumRMS() {EnsureLoaded(); FillSummaries(); return mSumRMS;}
 
     BlockSampleView GetFloatSampleView() override;
+    bool hasSampleView() override;
 
-    void SetSamples(constSamplePtr src, SampleFormat srcFormat, size_t numSamples);
+    //false if the samples never went past silenceThreshold, nothing is saved then
+    bool SetSamples(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold = -1.0f);
     void Commit(Sizes sizes);
     void Delete();
 
+    //Computes and saves the summaries if they were deferred, safe to call from any thread.
+    //false if the samples couldnt be read, the summaries stay pending then
+    bool FillSummaries();
+    bool summariesPending() const {return mSummariesPending.load();}
+
+    //when set, blocks are saved without summaries and the SummaryWorker fills them in later (into sampleSummaries)
+    static std::atomic<bool> sDeferSummaries;
+    static void setDeferSummaries(bool defer) {sDeferSummaries.store(defer);}
+    //memory the kept samples of pending blocks can take up, past that the worker reads them back from the db
+    static size_t sMaxPendingBytes;
+    static std::atomic<size_t> sPendingBytes;
+
 private:
     size_t DoGetSamples(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) override;
+    size_t ReadSamples(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples);
+    //0 when nothing is holding the decoded block
+    size_t ReadCached(samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples);
     MaxMinRMS DoGetMaxMinRMS(size_t start, size_t len) override;
     MaxMinRMS DoGetMaxMinRMS() override;
 
     bool GetSummaries(float* dest, size_t offset, size_t nFrames, DBConnection::statementID id, const char* sql);
-    bool CalcSummaries(Sizes sizes);
+    bool CalcSummaries(Sizes sizes, const float* samples);
 
     Sizes SetSizes(size_t numSamples, SampleFormat srcFormat);
 
     void load(SampleBlockID id);
+    void EnsureLoaded();
 
     //GetDBStuff
     DBConnection* Conn();
@@ -97,6 +126,32 @@ private:
 };
 
 
+//Keeps one blob handle open on the reading threads connection and moves it from block to block
+//with sqlite3_blob_reopen, so streaming through a sequence skips the statement step per read.
+//While the handle is open the connection holds a read transaction, so Close it once done streaming
+class SqliteSampleBlockReader
+    : public SampleBlockReader {
+
+    sqlite3_blob* mBlob = nullptr;
+    //connection the blob was opened on, reads from another thread have to reopen on their own
+    sqlite3* mBlobDB = nullptr;
+    SampleBlockID mBlobID = 0;
+
+    //keep the connection alive for as long as the blob might be
+    std::shared_ptr<DBConnection> mConn;
+
+public:
+    explicit SqliteSampleBlockReader(std::shared_ptr<DBConnection> conn) : mConn(conn) {}
+    ~SqliteSampleBlockReader() override;
+
+    size_t Read(SampleBlock& block, samplePtr dest, SampleFormat destFormat, size_t offset, size_t nSamples) override;
+    void Close() override;
+
+private:
+    bool OpenBlob(SampleBlockID id);
+};
+
+
 class SqliteSampleBlockFactory
     : public SampleBlockFactory
     , public std::enable_shared_from_this<SqliteSampleBlockFactory> {
@@ -106,6 +161,7 @@ class SqliteSampleBlockFactory
     allBlocksMap mAllBlocks;
 
     static std::map<SampleBlockID, std::shared_ptr<SqliteSampleBlock>> sSilentBlocks;
+    static std::mutex sSilentBlocksMutex;
 
     std::shared_ptr<DBConnection> mDB;
 
@@ -117,9 +173,11 @@ public:
     DBConnection* DBConn();
 
 protected:
-    SampleBlockPtr DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples) override;
+    SampleBlockPtr DoCreate(constSamplePtr src, SampleFormat srcFormat, size_t numSamples, float silenceThreshold) override;
     SampleBlockPtr DoCreateSilent(size_t nSamples, SampleFormat srcFormat) override;
     SampleBlockPtr DoCreateID(SampleFormat srcFormat, SampleBlockID srcBlockID) override;
+    SampleBlockPtr DoCreateDeferred(SampleFormat srcFormat, SampleBlockID srcBlockID, size_t numSamples) override;
+    SampleBlockReaderPtr DoCreateReader() override;
 
 };
 
@@ -0,0 +1,108 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "SummaryWorker.h"
+
+#include "SqliteSampleBlock.h"
+#include "../IO/AudioIO.h"
+
+std::chrono::milliseconds SummaryWorker::sRetryDelay {100};
+
+SummaryWorker::~SummaryWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCV.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+SummaryWorker &SummaryWorker::Get() {
+    static SummaryWorker worker;
+    return worker;
+}
+
+void SummaryWorker::Add(const std::shared_ptr<SqliteSampleBlock> &block) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(block);
+
+        //only start the thread once something actually needs it
+        if (!mThread.joinable()) {
+            mThread = std::thread([this] {workerThread();});
+        }
+    }
+    mCV.notify_all();
+}
+
+size_t SummaryWorker::pending() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() + mBusy;
+}
+
+void SummaryWorker::Drain() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (!mQueue.empty()) {
+        auto block = mQueue.front().lock();
+        mQueue.pop_front();
+
+        lock.unlock();
+        if (block) {
+            block->FillSummaries();
+        }
+        lock.lock();
+    }
+
+    //wait for whatever the worker was in the middle of
+    mCV.wait(lock, [this] {return !mBusy;});
+}
+
+void SummaryWorker::workerThread() {
+    while (true) {
+        std::shared_ptr<SqliteSampleBlock> block;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCV.wait(lock, [this] {return mStop || !mQueue.empty();});
+
+            if (mStop) {
+                return;
+            }
+
+            block = mQueue.front().lock();
+            mQueue.pop_front();
+            mBusy = true;
+        }
+
+        //let recording catch up before adding more disk work
+        auto db = AudioIOBase::sAudioDB;
+        while (db && db->getRecordPressure() >= DBConnection::sHighRecordPressure) {
+            using namespace std::chrono;
+            std::this_thread::sleep_for(10ms);
+        }
+
+        //couldnt read the block (an import batch that isnt committed yet), back to the end of the queue
+        const bool failed = block && !block->FillSummaries();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (failed) {
+                mQueue.push_back(block);
+            }
+            mBusy = false;
+        }
+        mCV.notify_all();
+
+        if (failed) {
+            std::this_thread::sleep_for(sRetryDelay);
+        }
+    }
+}
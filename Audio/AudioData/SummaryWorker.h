@@ -0,0 +1,53 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef SUMMARYWORKER_H
+#define SUMMARYWORKER_H
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class SqliteSampleBlock;
+
+//Background thread that computes the summaries for blocks saved with deferred summaries.
+//Backs off while the record path is under pressure so recording never waits on it.
+class SummaryWorker {
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCV;
+
+    std::deque<std::weak_ptr<SqliteSampleBlock>> mQueue;
+    bool mBusy = false;
+    bool mStop = false;
+
+public:
+    ~SummaryWorker();
+
+    static SummaryWorker& Get();
+
+    void Add(const std::shared_ptr<SqliteSampleBlock>& block);
+
+    //finishes everything queued, helping out on the calling thread, returns once nothing is pending.
+    //Blocks that cant be read are left pending and get filled in whenever their summaries are asked for
+    void Drain();
+
+    size_t pending();
+
+    //wait before trying a block that couldnt be read again
+    static std::chrono::milliseconds sRetryDelay;
+
+private:
+    void workerThread();
+};
+
+
+
+#endif //SUMMARYWORKER_H
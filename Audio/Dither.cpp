@@ -7,8 +7,10 @@
  */
 
 #include "Dither.h"
+#include <atomic>
 #include <wx/defs.h>
 
+#include "SampleKernels.h"
 #include "../MemoryManagement/Math/float_cast.h"
 
 // Constants for the noise shaping buffer
@@ -18,12 +20,7 @@ constexpr int BUF_MASK = 7;
 // Lipshitz's minimally audible FIR
 const float SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
-// Dither state
-struct State {
-    int mPhase;
-    float mTriangleState;
-    float mBuffer[8 /* = BUF_SIZE */];
-} mState;
+using State = Dither::State;
 
 using Ditherer = float (*)(State&, float);
 
@@ -31,8 +28,14 @@ using Ditherer = float (*)(State&, float);
 constexpr auto CONVERT_DIV16 = float(1<<15);
 constexpr auto CONVERT_DIV24 = float(1<<23);
 
-static inline float DITHER_NOISE() {
-    return rand() / (float) RAND_MAX - 0.5;
+//same generator as FillDitherNoise, just the first lane
+static inline float DITHER_NOISE(State& state) {
+    uint32_t x = state.mSeeds[0];
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state.mSeeds[0] = x;
+    return (x >> 8) / float(1 << 24) - 0.5f;
 }
 
 static inline float FROM_INT16(const short *ptr) {
@@ -106,9 +109,19 @@ Dither::Dither() {
 }
 
 void Dither::Reset() {
+    //channels dithered side by side cant share noise or it stops being random between them
+    static std::atomic<uint32_t> sNextSeed {1};
+
     mState.mPhase = 0;
     mState.mTriangleState = 0;
     memset(mState.mBuffer, 0, sizeof(float)*BUF_SIZE);
+
+    const uint32_t seed = sNextSeed.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t k = 0; k < 4; ++k) {
+        uint32_t x = (seed*4 + k + 1)*0x9E3779B9u;
+        x ^= x >> 16;
+        mState.mSeeds[k] = x ? x : 1;
+    }
 }
 
 void Dither::Apply(DitherType type,
@@ -181,13 +194,15 @@ void Dither::Apply(DitherType type,
             //unknown sample format
             wxASSERT(false);
         }
-    } else if (dstFormat==int24Sample, srcFormat==int16Sample) {
-        auto d = (float*) dst;
+    } else if (dstFormat==int24Sample && srcFormat==int16Sample) {
+        auto d = (int*) dst;
         auto s = (const short*) src;
 
         for (i = 0; i < len; i++, d+=dstStride, s+=srcStride) {
             *d = ((int)*s)<<8;
         }
+    } else if (srcFormat == floatSample && srcStride == 1 && dstStride == 1 && type != DitherType::shaped) {
+        ApplyFast(type, (const float*) src, dst, dstFormat, len);
     } else {
         //damn we have to dither :(
         switch (type) {
@@ -198,13 +213,9 @@ void Dither::Apply(DitherType type,
                 DITHER(RectangleDither, mState, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
                 break;
             case DitherType::triangle:
-                //needs to reset for this
-                Reset();
                 DITHER(TriangleDither, mState, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
                 break;
             case DitherType::shaped:
-                //needs to reset for this
-                Reset();
                 DITHER(ShapedDither,mState, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
                 break;
             default:
@@ -213,17 +224,54 @@ void Dither::Apply(DitherType type,
     }
 }
 
+void Dither::ApplyFast(DitherType type, const float *src, samplePtr dst, SampleFormat dstFormat, size_t len) {
+    constexpr size_t kChunk = 1024;
+    alignas(16) float noise[kChunk];
+
+    for (size_t done = 0; done < len;) {
+        const auto n = std::min(kChunk, len - done);
+
+        const float* pNoise = nullptr;
+        if (type != DitherType::none) {
+            FillDitherNoise(mState.mSeeds, noise, n);
+
+            if (type == DitherType::triangle) {
+                //high passed the same as TriangleDither, each sample gets its noise minus the last ones
+                float last = mState.mTriangleState;
+                for (size_t i = 0; i < n; ++i) {
+                    const float r = noise[i];
+                    noise[i] = r - last;
+                    last = r;
+                }
+                mState.mTriangleState = last;
+            }
+            pNoise = noise;
+        }
+
+        if (dstFormat == int16Sample) {
+            QuantizeToInt16(src + done, pNoise, (short*) dst + done, n);
+        } else if (dstFormat == int24Sample) {
+            QuantizeToInt24(src + done, pNoise, (int*) dst + done, n);
+        } else {
+            wxASSERT(false);
+            return;
+        }
+
+        done += n;
+    }
+}
+
 inline float NoDither(State &state, float sample) {
     return sample;
 }
 
 inline float RectangleDither(State &state, float sample) {
-    return sample - DITHER_NOISE();
+    return sample - DITHER_NOISE(state);
 }
 
 // Triangle dither - high pass filtered
 inline float TriangleDither(State &state, float sample) {
-    float r = DITHER_NOISE();
+    float r = DITHER_NOISE(state);
     float result = sample + r - state.mTriangleState;
     state.mTriangleState = r;
 
@@ -231,7 +279,7 @@ inline float TriangleDither(State &state, float sample) {
 }
 
 inline float ShapedDither(State &state, float sample) {
-    float r = DITHER_NOISE() + DITHER_NOISE();
+    float r = DITHER_NOISE(state) + DITHER_NOISE(state);
 
     // Run FIR
     float xe = sample + state.mBuffer[state.mPhase] * SHAPED_BS[0]
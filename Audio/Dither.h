@@ -9,6 +9,8 @@
 #ifndef DITHER_H
 #define DITHER_H
 
+#include <cstdint>
+
 #include "SampleFormat.h"
 
 enum DitherType : unsigned {
@@ -20,6 +22,15 @@ enum DitherType : unsigned {
 
 class Dither {
 public:
+    //every stream being dithered needs its own, the shaped filter and triangle high pass carry on from the last sample
+    struct State {
+        int mPhase;
+        float mTriangleState;
+        float mBuffer[8 /* = BUF_SIZE */];
+        //one xorshift generator per sse lane
+        uint32_t mSeeds[4];
+    };
+
     Dither();
 
     void Reset();
@@ -28,6 +39,12 @@ public:
     static DitherType FastDitherType();
     static DitherType BestDitherType();
 
+private:
+    //float to int16/int24 without strides, everything but shaped goes through the sse kernels
+    void ApplyFast(DitherType type, const float* src, samplePtr dst, SampleFormat dstFormat, size_t len);
+
+    State mState;
+
     // static EnumSettings<DitherType> FastSetting;
     // static EnumSettings<DitherType> BestSetting;
 };
@@ -18,6 +18,7 @@
 #include <wx/wxcrtvararg.h>
 
 #include "../Dither.h"
+#include "../AudioData/SummaryWorker.h"
 
 #ifdef __WXMSW__
     #include <pa_win_wasapi.h>
@@ -25,6 +26,7 @@
 
 
 std::shared_ptr<DBConnection> AudioIOBase::sAudioDB;
+size_t AudioIO::sMuteFadeLength = 256;
 std::unique_ptr<AudioIOBase> AudioIOBase::ugAudioIO;
 
 
@@ -139,6 +141,7 @@ int AudioIoCallback::AudioIOCallback(constSamplePtr inputBuffer, float* outputBu
     }
 
     FillOutputBuffers(outputBuffer, framesPerBuffer);
+    mOutputMeter.measure(outputBuffer, mMaxPLaybackChannels, framesPerBuffer);
 
     UpdateTimePosition(framesPerBuffer);
 
@@ -163,17 +166,21 @@ int AudioIoCallback::CallbackDoSeek() {
     mAudioThreadSequenceBufferExchangeLoopRunning.store(false);
     waitForAudioThreadStopped();
 
+    CancelWarmRecall();
+
     const auto time = mPlaybackShchedule.GetPolicy().OffsetSequenceTime(mPlaybackShchedule, mSeek);
 
     mPlaybackShchedule.SetSequenceTime(time);
     mSeek = 0;
 
     mSamplePos = (sampleCount)(time*mRate);
+    mPrefetcher.setPosition(mSamplePos, mPlaybackShchedule.ReversedTime());
 
     for (auto &buffer : mPlaybackBuffers) {
         const auto toDiscard = buffer->availForGet();
         buffer->discard( toDiscard );
     }
+    mLastCallbackFull = false;
 
     mPlaybackShchedule.mTimeQueue.Prime(time);
 
@@ -189,13 +196,17 @@ int AudioIoCallback::CallbackJumpToTime(){
     mAudioThreadSequenceBufferExchangeLoopRunning.store(false);
     waitForAudioThreadStopped();
 
+    CancelWarmRecall();
+
     mPlaybackShchedule.SetSequenceTime(mNewTime);
     mSamplePos =(sampleCount) (mNewTime*mRate);
+    mPrefetcher.setPosition(mSamplePos, mPlaybackShchedule.ReversedTime());
 
     for (auto &buffer : mPlaybackBuffers) {
         const auto toDiscard = buffer->availForGet();
         buffer->discard( toDiscard );
     }
+    mLastCallbackFull = false;
 
     mPlaybackShchedule.mTimeQueue.Prime(mNewTime);
 
@@ -207,13 +218,113 @@ int AudioIoCallback::CallbackJumpToTime(){
 
     waitForAudioThreadStarted();
 
+    mSnapshotCache.noteRecall(false, RecallMs());
+
     return paContinue;
 }
 
+bool AudioIoCallback::StartWarmRecall() {
+    if (mPlaybackShchedule.ReversedTime()) {
+        return false;
+    }
+
+    auto entry = mSnapshotCache.find(sampleCount(mNewTime*mRate));
+    if (!entry) {
+        return false;
+    }
+
+    mWarmEntry = entry;
+    mWarmOffset = 0;
+    mWarmTime = mNewTime;
+    mWarmResumeTime = mNewTime + entry->length/mRate;
+    mWarmRecallNoted = false;
+
+    mNewTime = -1.0;
+    mSeeking = 0;
+
+    mWarmRecall.store(eWarmRequested, std::memory_order_release);
+    return true;
+}
+
+size_t AudioIoCallback::FillFromWarm(float *outputFloats, unsigned long framesPerBuffer) {
+    const auto numMaxPlaybackChannels = mMaxPLaybackChannels;
+    const auto &entry = *mWarmEntry;
+    const auto len = std::min<size_t>(framesPerBuffer, entry.length - mWarmOffset);
+
+    //same channel order FillOutputBuffers takes the playback buffers in
+    int i = 0;
+    for (int x = 0; x < numMaxPlaybackChannels; ++x) {
+        const auto &pSeq = mPlaybackMap[x];
+        const float* src = nullptr;
+
+        if (pSeq) {
+            if (i < entry.channels.size() && !SequenceShouldBeSilent(*pSeq)) {
+                src = entry.channels[i].data() + mWarmOffset;
+            }
+            i++;
+        }
+
+        for (size_t f = 0; f < len; ++f) {
+            outputFloats[numMaxPlaybackChannels*f+x] = src ? src[f] : 0.0f;
+        }
+    }
+
+    mWarmOffset += len;
+    //only the shown time, the exchange thread owns the rest of the schedule until it has moved
+    mPlaybackShchedule.mTime.store(mWarmTime + mWarmOffset/mRate, std::memory_order_relaxed);
+
+    if (!mWarmRecallNoted) {
+        mSnapshotCache.noteRecall(true, RecallMs());
+        mWarmRecallNoted = true;
+    }
+
+    //exchange thread has stopped writing, whatever is still in the rings is from before the recall
+    if (mWarmRecall.load(std::memory_order_acquire) == eWarmRepositioned) {
+        for (auto &buffer : mPlaybackBuffers) {
+            buffer->discard(buffer->availForGet());
+        }
+        mWarmRecall.store(eWarmNone, std::memory_order_release);
+    }
+
+    mWarmFrames = framesPerBuffer;
+
+    if (mWarmOffset < entry.length) {
+        return framesPerBuffer;
+    }
+
+    //out of warm data, hold silence until the rings have audio from where it ended
+    if (mWarmRecall.load(std::memory_order_acquire) != eWarmNone || CommonlyReadyPlayback() == 0) {
+        for (size_t f = len; f < framesPerBuffer; ++f) {
+            for (int x = 0; x < numMaxPlaybackChannels; ++x) {
+                outputFloats[numMaxPlaybackChannels*f+x] = 0.0f;
+            }
+        }
+        return framesPerBuffer;
+    }
+
+    mWarmEntry.reset();
+    mWarmFrames = len;
+    return len;
+}
+
+void AudioIoCallback::CancelWarmRecall() {
+    mWarmEntry.reset();
+    mWarmOffset = 0;
+    mWarmRecall.store(eWarmNone, std::memory_order_release);
+}
+
+double AudioIoCallback::RecallMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mJumpRequested).count();
+}
+
 
 
 void AudioIoCallback::UpdateTimePosition(unsigned long framesPerBuffer) {
-    mPlaybackShchedule.SetSequenceTime(mPlaybackShchedule.mTimeQueue.Consumer(framesPerBuffer, mRate));
+    //a warm recall already moved the time along for what it played
+    if (mWarmFrames >= framesPerBuffer) {
+        return;
+    }
+    mPlaybackShchedule.SetSequenceTime(mPlaybackShchedule.mTimeQueue.Consumer(framesPerBuffer - mWarmFrames, mRate));
 }
 
 void AudioIoCallback::FillOutputBuffers(float* outputFloats, unsigned long framesPerBuffer) {
@@ -222,6 +333,7 @@ void AudioIoCallback::FillOutputBuffers(float* outputFloats, unsigned long frame
     const auto numMaxPlaybackChannels = mMaxPLaybackChannels;
 
     mMaxFramesOutput = 0;
+    mWarmFrames = 0;
 
     if (!outputFloats  || numPlaybackSequences <=0) {
         mMaxFramesOutput = framesPerBuffer;
@@ -238,7 +350,8 @@ void AudioIoCallback::FillOutputBuffers(float* outputFloats, unsigned long frame
         mCallbackReturn = CallbackDoSeek();
         mSeeking = 0;
     }
-    if (mNewTime != -1) {
+    //a warm recall starts straight away, otherwise (or while one is still handing over) take the slow path
+    if (mNewTime != -1 && mWarmRecall.load(std::memory_order_acquire) == eWarmNone && !StartWarmRecall()) {
         //SOLUTION TO FIX AUDIO BUFFERING WHILE SEEKING WITH A LARGE NUMBER OF TRACKS, LOOK AT LATER TO MAYBE MAKE SEEKING THREADED?
         if (!isPaused()&&mSeeking<3) {
             memset(outputFloats, 0, framesPerBuffer*SAMPLE_SIZE(floatSample)*mMaxPLaybackChannels);
@@ -249,8 +362,29 @@ void AudioIoCallback::FillOutputBuffers(float* outputFloats, unsigned long frame
         mSeeking = 0;
     }
 
+    if (mWarmEntry) {
+        //the rings are still catching up behind the warm data, running short here isnt an underrun
+        mLastCallbackFull = false;
+
+        const auto warmed = FillFromWarm(outputFloats, framesPerBuffer);
+        if (warmed == framesPerBuffer) {
+            return;
+        }
+
+        //warm data ran out part way through, the rest of the buffer comes from the rings
+        outputFloats += warmed*numMaxPlaybackChannels;
+        framesPerBuffer -= warmed;
+    }
+
     const auto toGet = std::min<size_t>(framesPerBuffer, CommonlyReadyPlayback());
 
+    //the rings ran dry after having kept up, the exchange thread deepens them when it sees this
+    const bool full = toGet == framesPerBuffer;
+    if (!full && mLastCallbackFull) {
+        mPlaybackUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    mLastCallbackFull = full;
+
     //--------- MEMORY ALLOCATIONS -----------
     const auto tempBufs = stackAllocate(float*, numPlaybackChannels);
 
@@ -299,6 +433,13 @@ void AudioIoCallback::DrainInputBuffers(constSamplePtr inputBuffer, unsigned lon
         return;
     }
 
+    //metered before the ring space check so the meters keep going even when samples get lost
+    if (mCaptureFormat == int16Sample) {
+        mInputMeter.measure((const short*) inputBuffer, numCaptureChannels, framesPerBuffer);
+    } else {
+        mInputMeter.measure((const float*) inputBuffer, numCaptureChannels, framesPerBuffer);
+    }
+
     //Note: this shouldnt be needed because uncapped recordings?
     // If there is no playback sequence this wont get checked so do it here
     // if (mPlaybackShchedule.GetPolicy().Done(mPlaybackShchedule, 0)) {
@@ -414,6 +555,7 @@ AudioIO::~AudioIO() {
 
 void AudioIO::Init() {
     sAudioDB = std::make_shared<DBConnection>();
+    Sequence::setHardDiskBlockSize(DBConnection::sSafeProfile.blockBytes);
     auto pAudioIO = new AudioIO();
     ugAudioIO.reset(pAudioIO);
     pAudioIO->startThread();
@@ -421,6 +563,7 @@ void AudioIO::Init() {
 
 void AudioIO::DeInit() {
     ugAudioIO.reset();
+    SummaryWorker::Get().Drain();
     sAudioDB->close();
     sAudioDB.reset();
 }
@@ -469,7 +612,7 @@ void AudioIoCallback:: processOnceAndWait() {
 
 
 int AudioIO::startStream(const TransportSequence &sequences, double t0, double t1, const audioIoStreamOptions &options) {
-    const auto &startTime = options.mStartTime;
+    auto startTime = options.mStartTime;
 
     mRecordingSchedule = {};
     mRecordingSchedule.mLatencyCorrection = -130/1000.0;
@@ -495,6 +638,16 @@ int AudioIO::startStream(const TransportSequence &sequences, double t0, double t
 
     mPlaybackShchedule.Init(t0, t1, mRecordingSequences.empty()?nullptr:&mRecordingSchedule);
 
+    if (options.mLoopRange) {
+        const auto [loopStart, loopEnd] = *options.mLoopRange;
+        mPlaybackShchedule.mpPlaybackPolicy = std::make_unique<LoopingPlaybackPolicy>(loopStart, std::min(loopEnd, t1));
+
+        //starting outside the loop would just play up to it, start at the top instead
+        if (!startTime || *startTime < loopStart || *startTime >= loopEnd) {
+            startTime = loopStart;
+        }
+    }
+
     bool successAudio = createPortAudioStream(options);
 
     mPlaybackShchedule.GetPolicy().Initialize(mRate);
@@ -507,18 +660,45 @@ int AudioIO::startStream(const TransportSequence &sequences, double t0, double t
 
     BuildMaps();
 
+    mInputMeter.setChannels(mNumCaptureChannels > 0 ? mMaxNumCaptureChannels : 0, mRate);
+    mOutputMeter.setChannels(mNumPlaybackChannels > 0 ? mMaxPLaybackChannels : 0, mRate);
+
     mSamplePos = sampleCount(t0*mRate);
 
     if (startTime) {
         auto time = *startTime;
 
         mPlaybackShchedule.SetSequenceTime(time);
-        mPlaybackShchedule.GetPolicy().OffsetSequenceTime(mPlaybackShchedule, 0);
+        time = mPlaybackShchedule.GetPolicy().OffsetSequenceTime(mPlaybackShchedule, 0);
         mSamplePos = sampleCount(time*mRate);
     }
 
     mPlaybackShchedule.mTimeQueue.Prime(mPlaybackShchedule.GetSequenceTime());
 
+    CancelWarmRecall();
+
+    if (!mPlayableSequences.empty()) {
+        mPrefetcher.start(mPlayableSequences, mRate, mSamplePos, mPlaybackShchedule.ReversedTime());
+        mSnapshotCache.start(mPlayableSequences, mRate);
+
+        if (options.mLoopRange) {
+            auto &loop = static_cast<LoopingPlaybackPolicy&>(mPlaybackShchedule.GetPolicy());
+            mPrefetcher.setLoop(sampleCount(loop.GetLoopStart()*mRate), sampleCount(loop.GetLoopEnd()*mRate));
+        }
+    }
+
+    //sequences that start out silent are skipped from the first pass, no fade needed
+    mbHasSoloSequences = CountSoloSequences();
+    mWasSilenced.assign(mPlayableSequences.size(), 0);
+    mUnmuting.assign(mPlayableSequences.size(), 0);
+    for (size_t s = 0; s < mPlayableSequences.size(); ++s) {
+        auto &pSeq = mPlayableSequences[s];
+        mWasSilenced[s] = pSeq && SequenceShouldBeSilent(*pSeq);
+        mPrefetcher.setSilenced(s, mWasSilenced[s]);
+    }
+    mReadsSkipped = 0;
+    mBytesSkipped = 0;
+
     //Trigger the audio thread to sequence buffers so the output buffers have data in them once the stream gets started
     mAudioThreadShouldSequenceBufferExchangeOnce.store(true, std::memory_order_release);
 
@@ -535,6 +715,8 @@ int AudioIO::startStream(const TransportSequence &sequences, double t0, double t
         std::cout<<"Error Starting the audio stream \n";
 
         stopAudioThread();
+        mPrefetcher.stop();
+        mSnapshotCache.stop();
 
         startStreamCleanup();
 
@@ -632,6 +814,14 @@ void AudioIO::stopStream() {
     //Ensure no data is lost from the buffers and dont make it into the recordable sequences
     processOnceAndWait();
 
+    mPrefetcher.stop();
+    mSnapshotCache.stop();
+    CancelWarmRecall();
+
+    for (auto &seq : mPlayableSequences) {
+        seq->finishReading();
+    }
+
     mPlaybackBuffers.clear();
     mPlaybackShchedule.mTimeQueue.Clear();
 
@@ -650,6 +840,14 @@ void AudioIO::stopStream() {
                     printf("Error saving sequence");
                 }
             }
+
+            //nothing left to capture so checkpoints can catch up
+            if (sAudioDB) {
+                sAudioDB->setRecordPressure(0.0f);
+            }
+
+            //recording is over so finish off any summaries that were put off
+            SummaryWorker::Get().Drain();
         }
     }
 
@@ -675,7 +873,7 @@ void AudioIO::startStreamCleanup(bool bClearBuffersOnly /*=false*/) {
 
 
 bool AudioIO::AllocateBuffers(double sampleRate) {
-    auto policy = mPlaybackShchedule.GetPolicy();
+    auto &policy = mPlaybackShchedule.GetPolicy();
 
     PlaybackPolicy::BufferTimes times = policy.SuggestedBufferTimes();
     auto playbackTime = lrint(times.batchSize.count() * mRate)/mRate;
@@ -687,6 +885,8 @@ bool AudioIO::AllocateBuffers(double sampleRate) {
     mCaptureBufferSecs = 4.5 + 0.5 * std::min(size_t(16), mNumCaptureChannels);
     mMinCaptureBufferSecsToCopy = 0.2 + 0.2*std::min(size_t(16), mNumCaptureChannels);
 
+    double maxRingSecs = PlaybackBufferTuner::sMaxDepthSecs;
+
     bool done;
     do {
         done = true;
@@ -695,7 +895,10 @@ bool AudioIO::AllocateBuffers(double sampleRate) {
                 auto bufferLength = std::max((size_t)lrint(mRate*mPlaybackBufferSecs), mHardwarePlaybackLatency*2);
 
                 //make buffer length a multiple of the sample rate
-                bufferLength = mPlaybackSamplesToCopy * (bufferLength+mPlaybackSamplesToCopy-1)/mPlaybackSamplesToCopy;
+                bufferLength = mPlaybackSamplesToCopy * ((bufferLength+mPlaybackSamplesToCopy-1)/mPlaybackSamplesToCopy);
+
+                //the rings are allocated at the most the tuner can ask for, bufferLength is just where filling starts
+                const auto capacity = std::max(bufferLength, (size_t)lrint(mRate*maxRingSecs));
 
                 //If we cant afford 100 samples crash out
                 if (bufferLength<100||mPlaybackSamplesToCopy<100) {
@@ -713,13 +916,13 @@ bool AudioIO::AllocateBuffers(double sampleRate) {
                 mProcessingBuffers.resize(mNumPlaybackChannels);
 
                 for(auto& buffer : mProcessingBuffers)
-                    buffer.reserve(bufferLength);
+                    buffer.reserve(capacity);
 
                 //Generate Buffers
                 std::generate(
                     mPlaybackBuffers.begin(),
                     mPlaybackBuffers.end(),
-                    [=] {return std::make_unique<audioBuffer>(floatSample, bufferLength); }
+                    [=] {return std::make_unique<audioBuffer>(floatSample, capacity); }
                 );
 
                 mPlaybackQueueMinimum = lrint(mRate *times.latency.count());
@@ -730,8 +933,16 @@ bool AudioIO::AllocateBuffers(double sampleRate) {
                 //Make the playback q min a multiple of playbacksamples
                 mPlaybackQueueMinimum = mPlaybackSamplesToCopy * ((mPlaybackQueueMinimum + mPlaybackSamplesToCopy -1)/mPlaybackSamplesToCopy);
 
-                const auto timeQueueSize = 1+(bufferLength+TimeQueueGrainSize-1)/TimeQueueGrainSize;
+                const auto timeQueueSize = 1+(capacity+TimeQueueGrainSize-1)/TimeQueueGrainSize;
                 mPlaybackShchedule.mTimeQueue.Init(timeQueueSize);
+
+                //starts at the suggested sizes, reads that keep up let it come down to a few hardware buffers
+                const auto hardwareBuffer = std::max<size_t>(mHardwarePlaybackLatency, 1);
+                const size_t minBatch = std::max(hardwareBuffer, (size_t)lrint(PlaybackBufferTuner::sMinBatchSecs*mRate));
+                const size_t minDepth = hardwareBuffer*PlaybackBufferTuner::sMinHardwareBuffers;
+                mBufferTuner.init(mRate, capacity, {minDepth, minBatch}, {bufferLength, mPlaybackSamplesToCopy});
+                mPlaybackRingDepth = mBufferTuner.getSizes().depth;
+                mUnderrunsSeen = mPlaybackUnderruns.load();
             }
             if (mNumCaptureChannels>0) {
                 auto bufferLength = (size_t)lrint(mRate*mCaptureBufferSecs);
@@ -770,6 +981,7 @@ bool AudioIO::AllocateBuffers(double sampleRate) {
 
             mPlaybackSamplesToCopy /=2;
             mPlaybackBufferSecs /=2;
+            maxRingSecs /=2;
             mCaptureBufferSecs /=2;
             mMinCaptureBufferSecsToCopy /=2;
 
@@ -848,6 +1060,12 @@ void AudioIO::DrainRecordBuffers() {
     //Might Need A Try Catch?
     {
         const auto avail = GetCommonlyAvailCapture();
+
+        //let the checkpoint thread know how far behind we are
+        if (sAudioDB && !mCaptureBuffers.empty()) {
+            sAudioDB->setRecordPressure((float)avail/mCaptureBuffers[0]->size());
+        }
+
         const auto remainingTime = std::max(0.0,  mRecordingSchedule.ToConsume());
         const auto remainingSamples = remainingTime * mRate;
         bool latencyCorrected = true;
@@ -940,16 +1158,37 @@ void AudioIO::FillPlayBuffers() {
         return;
     }
 
-    auto nAvail = GetCommonlyFreePlayback();
+    //a snapshot recall is playing from memory, carry on from where its data ends
+    switch (mWarmRecall.load(std::memory_order_acquire)) {
+        case eWarmRequested: {
+            RepositionForWarmRecall();
+            mWarmRecall.store(eWarmRepositioned, std::memory_order_release);
+        } return;
+        case eWarmRepositioned: {
+            //nothing gets written until the callback has thrown out the old audio
+        } return;
+        default:
+            break;
+    }
+
+    //the rings are allocated at their largest, only fill them to the depth the tuner picked
+    auto GetFree = [&] {
+        auto nWritten = GetCommonlyWrittenForPlayback();
+        return std::min(GetCommonlyFreePlayback(), mPlaybackRingDepth - std::min(nWritten, mPlaybackRingDepth));
+    };
+
+    auto nAvail = GetFree();
 
     //Dont Waste cpu processing if not enough sampels to cpy
     if (nAvail< mPlaybackSamplesToCopy) {
         return;
     }
 
+    //once the tuner has the rings below the suggested latency, full to the depth is as ready as they get
     auto GetNeeded = [&] {
         auto nReady = GetCommonlyWrittenForPlayback();
-        return mPlaybackQueueMinimum - std::min(nReady, mPlaybackQueueMinimum);
+        const auto minimum = std::min(mPlaybackQueueMinimum, mPlaybackRingDepth);
+        return minimum - std::min(nReady, minimum);
     };
 
     auto nNeeded = GetNeeded();
@@ -960,6 +1199,10 @@ void AudioIO::FillPlayBuffers() {
         }
     };
 
+    using Clock = std::chrono::steady_clock;
+    const auto passStart = Clock::now();
+    size_t produced = 0;
+
     while (true) {
         auto avail = std::min(nAvail, std::max(nNeeded, mPlaybackSamplesToCopy));
 
@@ -970,23 +1213,87 @@ void AudioIO::FillPlayBuffers() {
         if (!ProcessPlaybackSlices(avail)) {
             break;
         }
+        produced += avail;
 
         nNeeded = GetNeeded();
         if (nNeeded == 0) {
             break;
         }
 
-        nAvail = GetCommonlyFreePlayback();
+        nAvail = GetFree();
+    }
+
+    //only underruns while there was still something to read count, the end of playback drains the rings too
+    const auto underruns = mPlaybackUnderruns.load(std::memory_order_relaxed);
+    if (produced > 0) {
+        const std::chrono::duration<double> passTime = Clock::now() - passStart;
+        const std::chrono::duration<double> interval = mPlaybackShchedule.GetPolicy().SleepInterval(mPlaybackShchedule);
+
+        if (mBufferTuner.notePass(passTime.count(), produced, underruns != mUnderrunsSeen, interval.count())) {
+            const auto sizes = mBufferTuner.getSizes();
+            mPlaybackRingDepth = sizes.depth;
+            mPlaybackSamplesToCopy = sizes.batch;
+        }
     }
+    mUnderrunsSeen = underruns;
+
+    mPrefetcher.setPosition(mSamplePos, mPlaybackShchedule.ReversedTime());
+}
+
+void AudioIO::RepositionForWarmRecall() {
+    const auto time = mWarmResumeTime;
+
+    mPlaybackShchedule.RealTimeInit(time);
+    mSamplePos = sampleCount(time*mRate);
+    mPrefetcher.setPosition(mSamplePos, mPlaybackShchedule.ReversedTime());
+
+    //anything left over from a partial slice is from the old position
+    for (auto &buffer : mProcessingBuffers) {
+        buffer.clear();
+    }
+
+    mPlaybackShchedule.mTimeQueue.Prime(time);
 }
 
 bool AudioIO::ProcessPlaybackSlices(size_t avail) {
-    auto policy = mPlaybackShchedule.GetPolicy();
+    auto &policy = mPlaybackShchedule.GetPolicy();
 
     bool done = false;
     bool progress = false;
 
+    const auto numSequences = mPlayableSequences.size();
+    if (mWasSilenced.size() != numSequences) {
+        mWasSilenced.assign(numSequences, 0);
+        mUnmuting.assign(numSequences, 0);
+    }
 
+    //decide once per pass so a sequence doesnt flip between slices. Sequences that were already silent
+    //last pass dont get read at all, ones going silent get one more read so they can fade out
+    const auto silenced = stackAllocate(char, numSequences);
+    const auto skipRead = stackAllocate(char, numSequences);
+    for (size_t s = 0; s < numSequences; ++s) {
+        auto &pSeq = mPlayableSequences[s];
+        silenced[s] = pSeq && SequenceShouldBeSilent(*pSeq);
+        skipRead[s] = silenced[s] && mWasSilenced[s];
+
+        if (!mWasSilenced[s]) {
+            continue;
+        }
+        if (silenced[s]) {
+            //muted again before it got read
+            if (mUnmuting[s]) {
+                mUnmuting[s] = 0;
+                mPrefetcher.setSilenced(s, true);
+            }
+        } else if (!mUnmuting[s]) {
+            //nothing was fetched while it was silent, so give the prefetcher a pass to get it in and fade in on the next one
+            mUnmuting[s] = 1;
+            mPrefetcher.setSilenced(s, false);
+            skipRead[s] = 1;
+        } else {
+            mUnmuting[s] = 0;
+        }
+    }
 
     const auto processingBufferOffsets = stackAllocate(size_t, mProcessingBuffers.size());
     for(unsigned n = 0; n < mProcessingBuffers.size(); ++n)
@@ -1001,6 +1308,7 @@ bool AudioIO::ProcessPlaybackSlices(size_t avail) {
         mPlaybackShchedule.mTimeQueue.Producer(mPlaybackShchedule, slice);
 
         auto iBuffer = 0;
+        size_t s = 0;
 
         for (auto& pSeq : mPlayableSequences) {
             if (frames >0) {
@@ -1013,22 +1321,37 @@ bool AudioIO::ProcessPlaybackSlices(size_t avail) {
                     //ensuring enough space in the buffer
                     buffer.resize(buffer.size() + frames, 0);
 
-                    pSeq->GetFloats(i, (samplePtr) buffer.data()+appendPos, pos, toProduce, mPlaybackShchedule.ReversedTime());
+                    if (skipRead[s]) {
+                        //already zeroed by the resize. An unmuting sequence gets read by the prefetcher instead
+                        if (!mUnmuting[s]) {
+                            CountSkippedRead(*pSeq, i, pos, toProduce);
+                        }
+                        continue;
+                    }
+
+                    pSeq->GetFloats(i, (samplePtr) (buffer.data()+appendPos), pos, toProduce, mPlaybackShchedule.ReversedTime());
                 }
 
                 iBuffer+=nChannels;
             }
             mSamplePos = pos+toProduce;
+            s++;
         }
         avail-=frames;
 
+        //looping wraps here, between slices, so the next one in this pass already reads from the loop start
+        if (auto newTime = policy.RepositionPlayback(mPlaybackShchedule)) {
+            mSamplePos = sampleCount(llround(*newTime*mRate));
+        }
+
 
     } while (avail);
 
     //processing fx (mute/solo)
     {
         int iBuffer = 0;
-        for (auto pSeq: mPlayableSequences) {
+        for (size_t s = 0; s < numSequences; ++s) {
+            auto &pSeq = mPlayableSequences[s];
             if (!pSeq)
                 continue;
 
@@ -1036,15 +1359,27 @@ bool AudioIO::ProcessPlaybackSlices(size_t avail) {
 
             const auto len = mProcessingBuffers[iBuffer].size() - offset;
 
-            if (len >0) {
-                const auto silenced = SequenceShouldBeSilent(*pSeq);
+            if (len >0 && !skipRead[s] && silenced[s] != mWasSilenced[s]) {
+                //ramp over the start of what was just read, down to nothing when muting and up from nothing when unmuting
+                const auto fadeLen = std::min(len, sMuteFadeLength);
 
                 for (int i = 0; i < pSeq->NChannels(); ++i) {
-                    auto buffer = mProcessingBuffers[iBuffer+i];
+                    auto &buffer = mProcessingBuffers[iBuffer+i];
+                    auto samples = buffer.data()+offset;
 
-                    if (silenced) {
-                        std::fill_n(buffer.data()+offset, len,0);
+                    for (size_t f = 0; f < fadeLen; ++f) {
+                        const float gain = (float)f/fadeLen;
+                        samples[f] *= silenced[s] ? 1.0f - gain : gain;
                     }
+
+                    if (silenced[s]) {
+                        std::fill_n(samples+fadeLen, len-fadeLen, 0.0f);
+                    }
+                }
+
+                mWasSilenced[s] = silenced[s];
+                if (silenced[s]) {
+                    mPrefetcher.setSilenced(s, true);
                 }
             }
             iBuffer+=pSeq->NChannels();
@@ -1076,4 +1411,35 @@ bool AudioIO::ProcessPlaybackSlices(size_t avail) {
     }
 
     return progress;
+}
+
+void AudioIO::CountSkippedRead(const PlaybackSequence &seq, size_t channel, sampleCount start, size_t len) {
+    //the read would have gone backwards from start
+    if (mPlaybackShchedule.ReversedTime()) {
+        start -= len;
+    }
+    const sampleCount end = start + len;
+    start = std::max<sampleCount>(start, 0);
+
+    //one read per block like SequenceReader, unless something is holding the block decoded already
+    for (auto pos = start; pos < end;) {
+        mSkippedBlocks.clear();
+        seq.getUpcomingBlocks(channel, pos, false, 1, mSkippedBlocks);
+        if (mSkippedBlocks.empty()) {
+            return;
+        }
+
+        auto &block = mSkippedBlocks.front();
+        const auto blockEnd = block.start + block.sb->getSampleCount();
+        if (blockEnd <= pos) {
+            return;
+        }
+        const auto count = (std::min(end, blockEnd) - pos).as_size_t();
+
+        if (!block.sb->isSilent() && !block.sb->hasSampleView()) {
+            mReadsSkipped.fetch_add(1, std::memory_order_relaxed);
+            mBytesSkipped.fetch_add(count*SAMPLE_SIZE(block.sb->getSampleFormat()), std::memory_order_relaxed);
+        }
+        pos += count;
+    }
 }
\ No newline at end of file
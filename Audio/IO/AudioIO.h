@@ -14,8 +14,12 @@
 #include <thread>
 #include <vector>
 
+#include "BufferTuner.h"
+#include "LevelMeter.h"
 #include "PlaybackSchedules.h"
+#include "Prefetcher.h"
 #include "Resample.h"
+#include "SnapshotCache.h"
 #include "../audioBuffers.h"
 #include "../../Playback/Track.h"
 #include "../../Playback/Sequences/AudioIOSequences.h"
@@ -95,6 +99,15 @@ enum Acknowledge {
     eStop
 };
 
+//handshake between the callback and the exchange thread for a warm snapshot recall
+enum WarmRecall {
+    eWarmNone,
+    //callback is playing warm data, exchange thread needs to move to where it runs out
+    eWarmRequested,
+    //exchange thread moved and wont write until the callback throws out whats left in the rings
+    eWarmRepositioned
+};
+
 class AudioIoCallback
     : public AudioIOBase{
 
@@ -136,6 +149,10 @@ protected:
     std::atomic<bool> mAudioThreadSequenceBufferExchangeLoopRunning {false};
     std::atomic<Acknowledge> mAudioThreadAcknowledge { eNone };
 
+    //every device channel, measured in the callback
+    LevelMeter mInputMeter;
+    LevelMeter mOutputMeter;
+
     //buffers
     using audioBuffers = std::vector<std::unique_ptr<audioBuffer>>;
 
@@ -148,9 +165,29 @@ protected:
     sampleCount mSamplePos;
     //audioBuffer mMaster;
 
+    Prefetcher mPrefetcher;
+
+    //Snapshot recall
+    SnapshotCache mSnapshotCache;
+    SnapshotCache::EntryPtr mWarmEntry;
+    size_t mWarmOffset = 0;
+    //frames the warm data covered in the current callback
+    size_t mWarmFrames = 0;
+    double mWarmTime = 0;
+    double mWarmResumeTime = 0;
+    bool mWarmRecallNoted = false;
+    std::atomic<WarmRecall> mWarmRecall {eWarmNone};
+    std::chrono::steady_clock::time_point mJumpRequested;
+
     //buffer Settings
     double mPlaybackBufferSecs;
     size_t mPlaybackSamplesToCopy;
+    //how full the playback rings get kept, changes while playing
+    size_t mPlaybackRingDepth = 0;
+
+    //times the callback ran out of playback data mid stream, and whether the last callback had enough
+    std::atomic<size_t> mPlaybackUnderruns {0};
+    bool mLastCallbackFull = false;
 
     double mCaptureBufferSecs;
     double mMinCaptureBufferSecsToCopy;
@@ -193,8 +230,19 @@ public:
     double getCurrentPlaybackTime(){return mPlaybackShchedule.mCurrentTime;}
     double getRecordingTime(){return mRecordingSchedule.mPosition;}
 
+    Prefetcher::Stats getPrefetchStats() const {return mPrefetcher.getStats();}
+
     //Snapshots
-    void jumpToTime(double time){mNewTime = time;}
+    void jumpToTime(double time){mJumpRequested = std::chrono::steady_clock::now(); mNewTime = time;}
+    //keeps the start of these snapshots in memory while playing back so recalls dont wait on the disk
+    void setSnapshots(const std::vector<double>& times, int current) {mSnapshotCache.setSnapshots(times, current);}
+    SnapshotCache::Stats getRecallStats() const {return mSnapshotCache.getStats();}
+
+    //Metering, the levels are since the last call so only one thread should be polling each
+    std::vector<LevelMeter::Level> getInputLevels() {return mInputMeter.poll();}
+    std::vector<LevelMeter::Level> getOutputLevels() {return mOutputMeter.poll();}
+    LevelMeter::Stats getInputMeterStats() const {return mInputMeter.getStats();}
+    LevelMeter::Stats getOutputMeterStats() const {return mOutputMeter.getStats();}
 
 
 
@@ -202,6 +250,11 @@ protected:
     int CallbackDoSeek();
     int CallbackJumpToTime();
 
+    bool StartWarmRecall();
+    size_t FillFromWarm(float* outputFloats, unsigned long framesPerBuffer);
+    void CancelWarmRecall();
+    double RecallMs() const;
+
     void startAudioThread();
     void stopAudioThread();
 
@@ -234,6 +287,8 @@ struct audioIoStreamOptions {
     unsigned int mSampleRate = 0;
 
     std::optional<double> mStartTime;
+    //loop between these two times until stopped
+    std::optional<std::pair<double, double>> mLoopRange;
 };
 
 class AudioIO
@@ -247,6 +302,20 @@ class AudioIO
 
     size_t mPlaybackQueueMinimum;
 
+    //only touched by the exchange thread once the stream is going
+    PlaybackBufferTuner mBufferTuner;
+    size_t mUnderrunsSeen = 0;
+
+    //whether each playable sequence was silent on the last pass, only touched by the exchange thread
+    std::vector<char> mWasSilenced;
+    //sequences unmuted last pass, they stay quiet for one pass so the prefetcher can get their blocks in first
+    std::vector<char> mUnmuting;
+    std::vector<SeqBlock> mSkippedBlocks;
+
+    //block reads that would have gone to storage if the muted or not soloed sequences had been read
+    std::atomic<size_t> mReadsSkipped {0};
+    std::atomic<size_t> mBytesSkipped {0};
+
 
 public:
   //Init Functions
@@ -266,6 +335,17 @@ public:
 
     void togglePause();
 
+    struct SilenceStats {
+        size_t readsSkipped;
+        size_t bytesSkipped;
+    };
+    SilenceStats getSilenceStats() const {return {mReadsSkipped.load(), mBytesSkipped.load()};}
+
+    PlaybackBufferTuner::Stats getBufferStats() const {return mBufferTuner.getStats();}
+
+    //length of the ramp when a sequence gets muted or unmuted so it doesnt click
+    static size_t sMuteFadeLength;
+
 
 private:
 
@@ -286,7 +366,10 @@ private:
     //Buffer Exchange
     void DrainRecordBuffers();
     void FillPlayBuffers();
+    void RepositionForWarmRecall();
     bool ProcessPlaybackSlices(size_t avail);
+    //adds up the block reads a silenced channel would have needed from storage for [start, start+len)
+    void CountSkippedRead(const PlaybackSequence &seq, size_t channel, sampleCount start, size_t len);
 
 //Static Member Functions
 public:
@@ -0,0 +1,132 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "BufferTuner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+double PlaybackBufferTuner::sMaxDepthSecs = 2.0;
+double PlaybackBufferTuner::sMaxBatchSecs = 0.4;
+size_t PlaybackBufferTuner::sMinHardwareBuffers = 3;
+double PlaybackBufferTuner::sMinBatchSecs = 0.01;
+double PlaybackBufferTuner::sSafety = 3.0;
+double PlaybackBufferTuner::sBusyLoad = 0.5;
+double PlaybackBufferTuner::sIdleLoad = 0.1;
+double PlaybackBufferTuner::sShrinkDelaySecs = 5.0;
+
+void PlaybackBufferTuner::init(double rate, size_t capacity, Sizes minimum, Sizes initial) {
+    mRate = rate;
+    mCapacity = capacity;
+    mMinBatch = std::max<size_t>(std::min(minimum.batch, initial.batch), 1);
+    mMinDepth = std::min(std::max(minimum.depth, mMinBatch*2), mCapacity);
+
+    mBatch = std::max(initial.batch, mMinBatch);
+    mDepth = std::clamp(roundToBatch(initial.depth, mBatch), std::max(mMinDepth, mBatch*2), mCapacity);
+
+    mPeakPass = 0;
+    mLoad = 0;
+    mUnderruns = 0;
+    mChanges = 0;
+    mLastChange = std::chrono::steady_clock::now();
+
+    log("stream start");
+}
+
+bool PlaybackBufferTuner::notePass(double passSecs, size_t produced, bool underrun, double intervalSecs) {
+    if (produced == 0 || mRate <= 0) {
+        return false;
+    }
+
+    //a single slow read holds the peak up for a few seconds then it drifts back down
+    const auto peak = std::max(passSecs, mPeakPass.load(std::memory_order_relaxed)*0.99);
+    const auto load = mLoad.load(std::memory_order_relaxed)*0.9 + 0.1*passSecs/(produced/mRate);
+    mPeakPass.store(peak, std::memory_order_relaxed);
+    mLoad.store(load, std::memory_order_relaxed);
+
+    if (underrun) {
+        mUnderruns++;
+    }
+
+    const auto depth = mDepth.load(std::memory_order_relaxed);
+    const auto batch = mBatch.load(std::memory_order_relaxed);
+    const auto maxBatch = std::max(mMinBatch, std::min((size_t)lrint(sMaxBatchSecs*mRate), mCapacity/2));
+
+    auto newBatch = batch;
+    const char* batchReason = nullptr;
+    //reading is eating most of real time, fewer bigger reads cut the per read overhead
+    if (load > sBusyLoad && batch < maxBatch) {
+        newBatch = std::min(batch*2, maxBatch);
+        batchReason = "reads taking most of real time";
+    } else if (load < sIdleLoad && batch > mMinBatch) {
+        newBatch = std::max(batch/2, mMinBatch);
+        batchReason = "reads fast again";
+    }
+
+    //enough in the rings to ride out the slowest pass a few times over, plus the batch about to be read
+    auto target = newBatch + (size_t)lrint(sSafety*(peak + intervalSecs)*mRate);
+    if (underrun) {
+        target = std::max(target, depth + depth/2);
+    }
+    target = std::clamp(roundToBatch(target, newBatch), std::max(mMinDepth, newBatch*2), mCapacity);
+
+    const auto now = std::chrono::steady_clock::now();
+    const bool settled = std::chrono::duration<double>(now - mLastChange).count() >= sShrinkDelaySecs;
+
+    auto newDepth = depth;
+    const char* depthReason = nullptr;
+    if (target > depth) {
+        newDepth = target;
+        depthReason = underrun ? "underrun" : "slow reads";
+    } else if (settled && target < depth - depth/4) {
+        newDepth = target;
+        depthReason = "reads settled";
+    }
+
+    //a smaller batch can wait until the depth is allowed to change too, a bigger one cant
+    if (newBatch < batch && !settled) {
+        newBatch = batch;
+        batchReason = nullptr;
+    }
+    newDepth = std::max(newDepth, newBatch*2);
+
+    if (newDepth == depth && newBatch == batch) {
+        return false;
+    }
+
+    mDepth.store(newDepth, std::memory_order_relaxed);
+    mBatch.store(newBatch, std::memory_order_relaxed);
+    mLastChange = now;
+    mChanges++;
+
+    log(depthReason ? depthReason : batchReason);
+    return true;
+}
+
+PlaybackBufferTuner::Stats PlaybackBufferTuner::getStats() const {
+    const auto sizes = getSizes();
+    return {
+        mRate > 0 ? sizes.depth*1000/mRate : 0.0,
+        mRate > 0 ? sizes.batch*1000/mRate : 0.0,
+        mPeakPass.load()*1000,
+        mLoad.load(),
+        mUnderruns.load(),
+        mChanges.load()
+    };
+}
+
+size_t PlaybackBufferTuner::roundToBatch(size_t samples, size_t batch) const {
+    return batch * ((samples + batch - 1)/batch);
+}
+
+void PlaybackBufferTuner::log(const char *reason) const {
+    const auto stats = getStats();
+    std::cout<<"Playback buffering: rings "<<lrint(stats.depthMs)<<"ms, batches "<<lrint(stats.batchMs)<<"ms ("
+        <<(reason ? reason : "")<<", slowest pass "<<stats.peakPassMs<<"ms, "<<lrint(stats.load*100)<<"% load)"<<std::endl;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef BUFFERTUNER_H
+#define BUFFERTUNER_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+//Picks how deep the playback rings get filled and how much gets read per pass from how long the exchange
+//thread actually takes to read. The rings are allocated at sMaxDepthSecs so the depth can change mid stream.
+//Everything but getStats is only called from the exchange thread
+class PlaybackBufferTuner {
+public:
+    struct Sizes {
+        //samples the rings get filled to
+        size_t depth;
+        //samples read per pass
+        size_t batch;
+    };
+
+    struct Stats {
+        double depthMs;
+        double batchMs;
+        //slowest recent pass, decays over a few seconds
+        double peakPassMs;
+        //fraction of real time the exchange thread spends reading
+        double load;
+        size_t underruns;
+        size_t changes;
+    };
+
+private:
+    double mRate = 0;
+    size_t mCapacity = 0;
+    size_t mMinDepth = 0;
+    size_t mMinBatch = 0;
+
+    std::atomic<size_t> mDepth {0};
+    std::atomic<size_t> mBatch {0};
+
+    std::atomic<double> mPeakPass {0};
+    std::atomic<double> mLoad {0};
+    std::atomic<size_t> mUnderruns {0};
+    std::atomic<size_t> mChanges {0};
+
+    std::chrono::steady_clock::time_point mLastChange;
+
+public:
+    //initial comes from the policy's suggested times, minimum is as low as the device can take. Fast reads
+    //bring both sizes down from initial towards minimum, slow ones push them up towards the capacity
+    void init(double rate, size_t capacity, Sizes minimum, Sizes initial);
+
+    //after every pass that read something, returns true when the sizes changed
+    bool notePass(double passSecs, size_t produced, bool underrun, double intervalSecs);
+
+    Sizes getSizes() const {return {mDepth.load(std::memory_order_relaxed), mBatch.load(std::memory_order_relaxed)};}
+    Stats getStats() const;
+
+    //STATIC MEMBERS
+    static double sMaxDepthSecs;
+    static double sMaxBatchSecs;
+    //lower bounds, the rings never hold less than this many hardware buffers and batches never get shorter than this
+    static size_t sMinHardwareBuffers;
+    static double sMinBatchSecs;
+    //how many of the slowest pass (plus the sleep between passes) the rings should hold
+    static double sSafety;
+    //load above which batches get bigger, and below which they go back down
+    static double sBusyLoad;
+    static double sIdleLoad;
+    //the depth only comes back down after this long without needing to grow
+    static double sShrinkDelaySecs;
+
+private:
+    size_t roundToBatch(size_t samples, size_t batch) const;
+    void log(const char* reason) const;
+};
+
+
+
+#endif //BUFFERTUNER_H
@@ -0,0 +1,126 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "LevelMeter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "../SampleKernels.h"
+
+float LevelMeter::sPeakFallDb = 20.0f;
+float LevelMeter::sFloorDb = -99.0f;
+
+void LevelMeter::setChannels(size_t channels, double rate) {
+    mRate = rate;
+
+    mTotals = {};
+    mTotals.channels.resize(channels);
+    mShared.forEach([&](Totals& slot) {slot = mTotals;});
+
+    mPeaks.assign(channels, 0.0f);
+    mSumSqs.assign(channels, 0.0f);
+    mClips.assign(channels, 0);
+
+    mLastPoll = mTotals;
+    mLevels.assign(channels, {0.0f, 0.0f, 0, false});
+
+    mCalls = 0;
+    mNanos = 0;
+    mMaxNanos = 0;
+    mFramesMeasured = 0;
+}
+
+void LevelMeter::measure(const float *src, size_t channels, size_t len) {
+    measureWith(src, channels, len, 1.0f, MeasureInterleaved);
+}
+
+void LevelMeter::measure(const short *src, size_t channels, size_t len) {
+    //int16 tops out one step under full scale on the positive side
+    measureWith(src, channels, len, 32767.0f/32768.0f, MeasureInterleavedInt16);
+}
+
+template<typename Sample, typename Kernel>
+void LevelMeter::measureWith(const Sample *src, size_t channels, size_t len, float clipLevel, Kernel kernel) {
+    //sized for the stream in setChannels, anything else isnt what we were set up for
+    const auto numChannels = mTotals.channels.size();
+    if (!src || numChannels == 0 || channels != numChannels || len == 0) {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    kernel(src, channels, len, clipLevel, mPeaks.data(), mSumSqs.data(), mClips.data());
+
+    const auto fall = (float)std::pow(10.0, -sPeakFallDb*len/(20.0*mRate));
+    for (size_t c = 0; c < numChannels; ++c) {
+        auto& totals = mTotals.channels[c];
+        totals.peak = std::max(mPeaks[c], totals.peak*fall);
+        totals.sumSq += mSumSqs[c];
+        totals.clips += mClips[c];
+    }
+    mTotals.frames += len;
+
+    //the slot coming back is a few callbacks old so all of it gets written
+    auto& back = mShared.back();
+    std::copy(mTotals.channels.begin(), mTotals.channels.end(), back.channels.begin());
+    back.frames = mTotals.frames;
+    mShared.publish();
+
+    const uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    mCalls.fetch_add(1, std::memory_order_relaxed);
+    mNanos.fetch_add(nanos, std::memory_order_relaxed);
+    mFramesMeasured.fetch_add(len, std::memory_order_relaxed);
+    //only the callback writes it
+    if (nanos > mMaxNanos.load(std::memory_order_relaxed)) {
+        mMaxNanos.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+std::vector<LevelMeter::Level> LevelMeter::poll() {
+    if (mShared.update()) {
+        const auto& totals = mShared.front();
+        const auto frames = totals.frames - mLastPoll.frames;
+
+        for (size_t c = 0; c < mLevels.size(); ++c) {
+            const auto& now = totals.channels[c];
+            const auto& last = mLastPoll.channels[c];
+            auto& level = mLevels[c];
+
+            level.peak = now.peak;
+            if (frames > 0) {
+                level.rms = (float)std::sqrt(std::max(0.0, now.sumSq - last.sumSq)/frames);
+            }
+            level.clipping = now.clips > last.clips;
+            level.clips = now.clips;
+        }
+        mLastPoll = totals;
+    }
+
+    return mLevels;
+}
+
+LevelMeter::Stats LevelMeter::getStats() const {
+    const auto calls = mCalls.load(std::memory_order_relaxed);
+    const auto nanos = (double)mNanos.load(std::memory_order_relaxed);
+    const auto frames = mFramesMeasured.load(std::memory_order_relaxed);
+
+    Stats stats {0, mMaxNanos.load(std::memory_order_relaxed)/1000.0, 0};
+    if (calls > 0) {
+        stats.avgUs = nanos/calls/1000.0;
+    }
+    if (frames > 0) {
+        stats.load = nanos/(frames/mRate*1e9);
+    }
+    return stats;
+}
+
+float LevelMeter::toDb(float level) {
+    return level > 0 ? std::max(sFloorDb, 20.0f*std::log10(level)) : sFloorDb;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef LEVELMETER_H
+#define LEVELMETER_H
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "../../Threading/TripleBuffer.h"
+
+//Peak/rms/clip meter for every channel going through the callback. measure runs in the callback on the interleaved
+//buffer it already has and publishes running totals through a triple buffer, poll turns them into levels on the ui
+//thread. Neither side locks or waits on the other
+class LevelMeter {
+public:
+    struct Level {
+        //linear, the peak falls back at sPeakFallDb a second so nothing between polls gets missed
+        float peak;
+        //over everything since the last poll
+        float rms;
+        //samples at full scale since the stream started
+        uint64_t clips;
+        //clipped since the last poll
+        bool clipping;
+    };
+
+    struct Stats {
+        //time measure takes per callback
+        double avgUs;
+        double maxUs;
+        //share of the audio time spent metering
+        double load;
+    };
+
+private:
+    struct ChannelTotals {
+        float peak = 0;
+        double sumSq = 0;
+        uint64_t clips = 0;
+    };
+    struct Totals {
+        std::vector<ChannelTotals> channels;
+        uint64_t frames = 0;
+    };
+
+    TripleBuffer<Totals> mShared;
+    double mRate = 44100;
+
+    //callback only
+    Totals mTotals;
+    std::vector<float> mPeaks;
+    std::vector<float> mSumSqs;
+    std::vector<uint32_t> mClips;
+
+    //ui only
+    Totals mLastPoll;
+    std::vector<Level> mLevels;
+
+    std::atomic<uint64_t> mCalls {0};
+    std::atomic<uint64_t> mNanos {0};
+    std::atomic<uint64_t> mMaxNanos {0};
+    std::atomic<uint64_t> mFramesMeasured {0};
+
+public:
+    //not while the stream is running, everything gets allocated here so measure never does
+    void setChannels(size_t channels, double rate);
+    size_t getNumChannels() const {return mTotals.channels.size();}
+
+    //src holds len frames of interleaved samples, channels has to match what setChannels was given
+    void measure(const float* src, size_t channels, size_t len);
+    void measure(const short* src, size_t channels, size_t len);
+
+    //one thread at a time
+    std::vector<Level> poll();
+    Stats getStats() const;
+
+    static float toDb(float level);
+
+    //STATIC MEMBERS
+    static float sPeakFallDb;
+    //lowest level toDb gives back
+    static float sFloorDb;
+
+private:
+    template<typename Sample, typename Kernel>
+    void measureWith(const Sample* src, size_t channels, size_t len, float clipLevel, Kernel kernel);
+};
+
+
+
+#endif //LEVELMETER_H
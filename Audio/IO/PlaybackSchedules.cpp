@@ -87,6 +87,73 @@ std::pair<double, double> PlaybackPolicy::AdvancedTrackTime(PlaybackSchedule &sc
 }
 
 
+//Looping
+LoopingPlaybackPolicy::LoopingPlaybackPolicy(double loopStart, double loopEnd)
+    : mLoopStart(std::max(0.0, loopStart)), mLoopEnd(loopEnd) {
+    //needs some length or slices never make it anywhere
+    mLoopEnd = std::max(mLoopEnd, mLoopStart + 0.1);
+}
+
+bool LoopingPlaybackPolicy::Done(PlaybackSchedule &schedule, unsigned long outputFrames) {
+    //runs until its stopped
+    return false;
+}
+
+double LoopingPlaybackPolicy::OffsetSequenceTime(PlaybackSchedule &schedule, double offset) {
+    auto time = Wrap(schedule.GetSequenceTime() + offset);
+
+    schedule.RealTimeInit(time);
+
+    return time;
+}
+
+std::pair<double, double> LoopingPlaybackPolicy::AdvancedTrackTime(PlaybackSchedule &schedule, double trackTime, size_t nSamples) {
+    trackTime += nSamples/mRate;
+
+    //slices stop right on the loop end, so hitting it (give or take rounding) means the next sample is the loop start
+    if (trackTime >= mLoopEnd - 0.5/mRate) {
+        trackTime = mLoopStart + std::max(0.0, trackTime - mLoopEnd);
+    }
+
+    return {trackTime, trackTime};
+}
+
+PlaybackSlice LoopingPlaybackPolicy::GetPlaybackSlice(PlaybackSchedule &schedule, size_t available) {
+    const auto remaining = std::max(0LL, SamplesToLoopEnd(schedule));
+    const auto toProduce = std::min<size_t>(available, remaining);
+
+    schedule.RealTimeAdvance(toProduce/mRate);
+
+    return {available, toProduce, toProduce};
+}
+
+std::optional<double> LoopingPlaybackPolicy::RepositionPlayback(PlaybackSchedule &schedule) {
+    if (SamplesToLoopEnd(schedule) > 0) {
+        return std::nullopt;
+    }
+
+    schedule.RealTimeInit(mLoopStart);
+    return mLoopStart;
+}
+
+double LoopingPlaybackPolicy::Wrap(double time) const {
+    const auto length = mLoopEnd - mLoopStart;
+
+    auto offset = fmod(time - mLoopStart, length);
+    if (offset < 0) {
+        offset += length;
+    }
+
+    return mLoopStart + offset;
+}
+
+long long LoopingPlaybackPolicy::SamplesToLoopEnd(PlaybackSchedule &schedule) const {
+    //rounded to whole samples so the seam doesnt drift as the doubles add up
+    const auto position = llround((schedule.mT0 + schedule.mCurrentTime)*mRate);
+    return llround(mLoopEnd*mRate) - position;
+}
+
+
 const PlaybackPolicy &PlaybackSchedule::GetPolicy() const {
     return const_cast<PlaybackSchedule&>(*this).GetPolicy();
 }
@@ -11,6 +11,8 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <optional>
 
 struct audioIoStreamOptions;
 
@@ -74,7 +76,7 @@ public:
         return 10ms;
     }
 
-    std::pair<double, double>
+    virtual std::pair<double, double>
       AdvancedTrackTime( PlaybackSchedule &schedule,
          double trackTime, size_t nSamples );
 
@@ -82,6 +84,44 @@ public:
     virtual PlaybackSlice GetPlaybackSlice( PlaybackSchedule &schedule,
        size_t available
     );
+
+    //called after every slice, returns the track time to carry on reading from if playback has to jump
+    virtual std::optional<double> RepositionPlayback( PlaybackSchedule &schedule ) { return std::nullopt; }
+
+    virtual ~PlaybackPolicy() = default;
+};
+
+//Plays between two times over and over. Slices are cut exactly at the loop end so the next one
+//starts back at the loop start in the same pass, the rings never drain at the seam
+class LoopingPlaybackPolicy final
+    : public PlaybackPolicy {
+    double mLoopStart;
+    double mLoopEnd;
+
+public:
+    LoopingPlaybackPolicy(double loopStart, double loopEnd);
+
+    double GetLoopStart() const { return mLoopStart; }
+    double GetLoopEnd() const { return mLoopEnd; }
+
+    bool Done( PlaybackSchedule &schedule, unsigned long outputFrames ) override;
+
+    double OffsetSequenceTime( PlaybackSchedule &schedule, double offset ) override;
+
+    std::pair<double, double>
+      AdvancedTrackTime( PlaybackSchedule &schedule,
+         double trackTime, size_t nSamples ) override;
+
+    PlaybackSlice GetPlaybackSlice( PlaybackSchedule &schedule,
+       size_t available ) override;
+
+    std::optional<double> RepositionPlayback( PlaybackSchedule &schedule ) override;
+
+private:
+    //wraps a time past the end back into the loop
+    double Wrap(double time) const;
+    //samples from the producers position to the loop end
+    long long SamplesToLoopEnd(PlaybackSchedule &schedule) const;
 };
 
 struct PlaybackSchedule {
@@ -0,0 +1,253 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "Prefetcher.h"
+
+#include <algorithm>
+#include <limits>
+
+
+size_t Prefetcher::sBlocksAhead = 3;
+size_t Prefetcher::sMaxCacheBytes = 256*1024*1024;
+
+Prefetcher::~Prefetcher() {
+    stop();
+}
+
+void Prefetcher::start(const constPlayableSequences &sequences, double rate, sampleCount position, bool backwards) {
+    stop();
+
+    mSequences = sequences;
+    mRate = rate;
+    mStop = false;
+    mSilenced.assign(sequences.size(), 0);
+    mLoopStart = -1;
+    mLoopEnd = -1;
+
+    mPosition.store(position.as_long_long(), std::memory_order_relaxed);
+    mBackwards.store(backwards, std::memory_order_relaxed);
+
+    mPrefetched = 0;
+    mLeadTotal = 0;
+    mLeadMin = std::numeric_limits<double>::infinity();
+    mReadsStart = sumReadCounts();
+    mPlaybackHits = 0;
+    mPlaybackMisses = 0;
+
+    mThread = std::thread([this] {prefetchThread();});
+}
+
+void Prefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCV.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+        //the last few passes since the thread last looked
+        updateHitRate();
+    }
+
+    mCache.clear();
+    mCacheBytes = 0;
+    mSequences.clear();
+}
+
+void Prefetcher::setPosition(sampleCount position, bool backwards) {
+    mPosition.store(position.as_long_long(), std::memory_order_relaxed);
+    mBackwards.store(backwards, std::memory_order_relaxed);
+    mCV.notify_one();
+}
+
+void Prefetcher::setSilenced(size_t sequence, bool silenced) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (sequence >= mSilenced.size()) {
+            return;
+        }
+        mSilenced[sequence] = silenced;
+    }
+    if (!silenced) {
+        mCV.notify_one();
+    }
+}
+
+void Prefetcher::setLoop(sampleCount start, sampleCount end) {
+    mLoopStart.store(start.as_long_long(), std::memory_order_relaxed);
+    mLoopEnd.store(end.as_long_long(), std::memory_order_relaxed);
+    mCV.notify_one();
+}
+
+Prefetcher::Stats Prefetcher::getStats() const {
+    auto cached = mPlaybackHits.load();
+    auto storage = mPlaybackMisses.load();
+    auto prefetched = mPrefetched.load();
+
+    return {
+        prefetched,
+        cached + storage ? (double)cached/(cached + storage) : 0.0,
+        prefetched ? mLeadTotal.load()/prefetched : 0.0,
+        prefetched ? mLeadMin.load() : 0.0
+    };
+}
+
+ReadCounts Prefetcher::sumReadCounts() const {
+    ReadCounts total;
+    for (auto& pSeq : mSequences) {
+        if (pSeq) {
+            auto counts = pSeq->getReadCounts();
+            total.cached += counts.cached;
+            total.storage += counts.storage;
+        }
+    }
+    return total;
+}
+
+void Prefetcher::updateHitRate() {
+    auto counts = sumReadCounts();
+    mPlaybackHits.store(counts.cached - mReadsStart.cached, std::memory_order_relaxed);
+    mPlaybackMisses.store(counts.storage - mReadsStart.storage, std::memory_order_relaxed);
+}
+
+void Prefetcher::prefetchThread() {
+    while (true) {
+        bool loaded = prefetchPass();
+        updateHitRate();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mStop) {
+            return;
+        }
+
+        //if nothing needed loading wait for the exchange thread to move on
+        if (!loaded) {
+            using namespace std::chrono;
+            mCV.wait_for(lock, 10ms, [this] {return mStop.load();});
+            if (mStop) {
+                return;
+            }
+        }
+    }
+}
+
+bool Prefetcher::prefetchPass() {
+    const auto pos = mPosition.load(std::memory_order_relaxed);
+    const auto backwards = mBackwards.load(std::memory_order_relaxed);
+
+    //samples from the read position to where the block starts being played
+    auto distance = [&](const SeqBlock& seqBlock) {
+        auto start = seqBlock.start.as_long_long();
+        auto end = start + (long long)seqBlock.sb->getSampleCount();
+        return std::max(0LL, backwards ? pos - end : start - pos);
+    };
+
+    const auto loopStart = mLoopStart.load(std::memory_order_relaxed);
+    const auto loopEnd = mLoopEnd.load(std::memory_order_relaxed);
+    const bool looping = loopStart >= 0 && loopEnd > loopStart && !backwards;
+
+    std::vector<char> silenced;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        silenced = mSilenced;
+    }
+
+    std::vector<std::pair<long long, SeqBlock>> upcoming;
+    std::vector<SeqBlock> blocks;
+    for (size_t s = 0; s < mSequences.size(); ++s) {
+        auto& pSeq = mSequences[s];
+        if (!pSeq || (s < silenced.size() && silenced[s])) {
+            continue;
+        }
+        for (size_t channel = 0; channel < pSeq->NChannels(); ++channel) {
+            blocks.clear();
+            pSeq->getUpcomingBlocks(channel, pos, backwards, sBlocksAhead, blocks);
+            for (auto& block : blocks) {
+                //nothing past the loop end gets played
+                if (looping && block.start >= loopEnd) {
+                    break;
+                }
+                if (!block.sb->isSilent()) {
+                    upcoming.emplace_back(distance(block), block);
+                }
+            }
+
+            //the loop start is needed as soon as the read position gets to the loop end
+            if (looping) {
+                blocks.clear();
+                pSeq->getUpcomingBlocks(channel, loopStart, false, 1, blocks);
+                for (auto& block : blocks) {
+                    if (!block.sb->isSilent()) {
+                        upcoming.emplace_back(std::max(0LL, loopEnd - pos), block);
+                    }
+                }
+            }
+        }
+    }
+
+    //closest first so every sequence gets its next block before anyone gets their third
+    std::stable_sort(upcoming.begin(), upcoming.end(), [](auto& a, auto& b) {return a.first < b.first;});
+
+    std::vector<SampleBlockPtr> wanted;
+    wanted.reserve(upcoming.size());
+    for (auto& entry : upcoming) {
+        wanted.push_back(entry.second.sb);
+    }
+
+    evict(wanted);
+
+    for (auto& [dist, seqBlock] : upcoming) {
+        if (mStop) {
+            return false;
+        }
+
+        auto iter = std::find_if(mCache.begin(), mCache.end(), [&](auto& cached) {return cached.block == seqBlock.sb;});
+        if (iter != mCache.end()) {
+            mCache.splice(mCache.begin(), mCache, iter);
+            continue;
+        }
+
+        size_t bytes = seqBlock.sb->getSampleCount()*sizeof(float);
+        if (mCacheBytes + bytes > sMaxCacheBytes) {
+            //out of budget, whatever is left gets read the normal way
+            return false;
+        }
+
+        auto view = seqBlock.sb->GetFloatSampleView();
+
+        //how far ahead of the read position the block was when it became ready
+        auto now = mPosition.load(std::memory_order_relaxed);
+        auto lead = dist - (backwards ? pos - now : now - pos);
+        double leadSecs = mRate > 0 ? lead/mRate : 0;
+
+        mLeadTotal = mLeadTotal.load() + leadSecs;
+        mLeadMin = std::min(mLeadMin.load(), leadSecs);
+        mPrefetched++;
+
+        mCache.push_front({seqBlock.sb, view, bytes});
+        mCacheBytes += bytes;
+
+        //one block per pass so a seek is picked up quickly
+        return true;
+    }
+
+    return false;
+}
+
+void Prefetcher::evict(const std::vector<SampleBlockPtr> &wanted) {
+    //drop everything the read position has moved past
+    for (auto iter = mCache.begin(); iter != mCache.end();) {
+        if (std::find(wanted.begin(), wanted.end(), iter->block) == wanted.end()) {
+            mCacheBytes -= iter->bytes;
+            iter = mCache.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "../../Playback/Sequences/AudioIOSequences.h"
+
+//Reads the next few blocks of every playing sequence ahead of the exchange thread so it (almost) never
+//has to go to the db itself. Blocks are held as float sample views, which SqliteSampleBlock reads from while alive.
+class Prefetcher {
+    struct CachedBlock {
+        SampleBlockPtr block;
+        BlockSampleView view;
+        size_t bytes;
+    };
+
+    constPlayableSequences mSequences;
+    double mRate = 0;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCV;
+    std::atomic<bool> mStop {false};
+
+    std::atomic<long long> mPosition {0};
+    std::atomic<bool> mBackwards {false};
+
+    //when looping, the blocks at the loop start are kept ready for the wrap, -1 when not looping
+    std::atomic<long long> mLoopStart {-1};
+    std::atomic<long long> mLoopEnd {-1};
+
+    //silenced sequences arent played so nothing gets fetched for them, guarded by mMutex
+    std::vector<char> mSilenced;
+
+    //front is the most recently wanted
+    std::list<CachedBlock> mCache;
+    size_t mCacheBytes = 0;
+
+    //stats
+    std::atomic<size_t> mPrefetched {0};
+    std::atomic<double> mLeadTotal {0};
+    std::atomic<double> mLeadMin {0};
+    //playback reads of the sequences when started, and since then (updated by the prefetch thread)
+    ReadCounts mReadsStart;
+    std::atomic<size_t> mPlaybackHits {0};
+    std::atomic<size_t> mPlaybackMisses {0};
+
+public:
+    struct Stats {
+        size_t prefetched;
+        double hitRate;
+        //how far ahead of the read position the blocks were ready, in seconds
+        double avgLead;
+        double minLead;
+    };
+
+    ~Prefetcher();
+
+    void start(const constPlayableSequences& sequences, double rate, sampleCount position, bool backwards);
+    void stop();
+
+    //called by the exchange thread after every pass with where it will read next
+    void setPosition(sampleCount position, bool backwards);
+    //index into the sequences passed to start, unmuting wakes the thread so the sequence gets its blocks right away.
+    //AudioIO holds an unmuted sequence back one pass for that
+    void setSilenced(size_t sequence, bool silenced);
+    void setLoop(sampleCount start, sampleCount end);
+
+    Stats getStats() const;
+
+    //STATIC MEMBERS
+    //blocks to keep ready ahead of the read position per channel
+    static size_t sBlocksAhead;
+    static size_t sMaxCacheBytes;
+
+private:
+    void prefetchThread();
+    ReadCounts sumReadCounts() const;
+    void updateHitRate();
+    bool prefetchPass();
+    void evict(const std::vector<SampleBlockPtr>& wanted);
+};
+
+
+
+#endif //PREFETCHER_H
@@ -0,0 +1,274 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "SnapshotCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+double SnapshotCache::sWarmSecs = 0.5;
+int SnapshotCache::sNeighbours = 2;
+size_t SnapshotCache::sMaxBytes = 128*1024*1024;
+std::chrono::milliseconds SnapshotCache::sRetireCheck {100};
+
+SnapshotCache::~SnapshotCache() {
+    stop();
+}
+
+void SnapshotCache::start(const constPlayableSequences &sequences, double rate) {
+    stop();
+
+    mSequences = sequences;
+    mRate = rate;
+    mStop = false;
+    mChanged = true;
+
+    mRecalls = 0;
+    mWarmRecalls = 0;
+    mLastRecallMs = 0;
+    mTotalRecallMs = 0;
+    mMaxRecallMs = 0;
+
+    mThread = std::thread([this] {warmThread();});
+}
+
+void SnapshotCache::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCV.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mEntryMutex);
+        mEntries.clear();
+    }
+    mRetired.clear();
+    mBytes = 0;
+    mSequences.clear();
+}
+
+void SnapshotCache::setSnapshots(const std::vector<double> &times, int current) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimes = times;
+        mCurrent = current;
+        mChanged = true;
+    }
+    mCV.notify_one();
+}
+
+SnapshotCache::EntryPtr SnapshotCache::find(sampleCount position) {
+    std::unique_lock<std::mutex> lock(mEntryMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        //the warm thread is swapping entries, this recall just goes the slow way
+        return nullptr;
+    }
+
+    for (auto& entry : mEntries) {
+        if (entry->position == position) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void SnapshotCache::noteRecall(bool warm, double ms) {
+    mRecalls++;
+    if (warm) {
+        mWarmRecalls++;
+    }
+    mLastRecallMs = ms;
+    mTotalRecallMs = mTotalRecallMs.load() + ms;
+    mMaxRecallMs = std::max(mMaxRecallMs.load(), ms);
+}
+
+SnapshotCache::Stats SnapshotCache::getStats() const {
+    auto recalls = mRecalls.load();
+
+    size_t warm;
+    {
+        std::lock_guard<std::mutex> lock(mEntryMutex);
+        warm = mEntries.size();
+    }
+
+    return {
+        warm,
+        mBytes.load(),
+        recalls,
+        mWarmRecalls.load(),
+        mLastRecallMs.load(),
+        recalls ? mTotalRecallMs.load()/recalls : 0.0,
+        mMaxRecallMs.load()
+    };
+}
+
+void SnapshotCache::warmThread() {
+    while (true) {
+        bool warmed = warmPass();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mStop) {
+            return;
+        }
+
+        //everything wanted is warm, sleep until the snapshots change (waking up now and then to free retired entries)
+        if (!warmed) {
+            auto wake = [this] {return mStop.load() || mChanged.load();};
+            if (mRetired.empty()) {
+                mCV.wait(lock, wake);
+            } else {
+                mCV.wait_for(lock, sRetireCheck, wake);
+                lock.unlock();
+                releaseRetired();
+                continue;
+            }
+            if (mStop) {
+                return;
+            }
+        }
+    }
+}
+
+void SnapshotCache::releaseRetired() {
+    //find only hands out what is in mEntries, so once nobody else holds one nobody can get it again
+    mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(), [](const EntryPtr& entry) {return entry.use_count() == 1;}), mRetired.end());
+}
+
+bool SnapshotCache::warmPass() {
+    releaseRetired();
+
+    std::vector<double> times;
+    int current;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        times = mTimes;
+        current = mCurrent;
+        mChanged = false;
+    }
+
+    size_t numChannels = 0;
+    for (auto& pSeq : mSequences) {
+        numChannels += pSeq ? pSeq->NChannels() : 0;
+    }
+    if (numChannels == 0 || mRate <= 0) {
+        return false;
+    }
+
+    //nearest to the current snapshot first, thats where recalls usually go
+    std::vector<int> order(times.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {return std::abs(a - current) < std::abs(b - current);});
+
+    const size_t entryBytes = numChannels*(size_t)(sWarmSecs*mRate)*sizeof(float);
+
+    std::vector<sampleCount> wanted;
+    size_t budget = 0;
+    for (auto i : order) {
+        //the neighbours are always kept, everything else has to fit
+        if (budget + entryBytes > sMaxBytes && std::abs(i - current) > sNeighbours) {
+            break;
+        }
+
+        auto position = sampleCount(times[i]*mRate);
+        if (times[i] < 0 || std::find(wanted.begin(), wanted.end(), position) != wanted.end()) {
+            continue;
+        }
+
+        wanted.push_back(position);
+        budget += entryBytes;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mEntryMutex);
+        for (auto iter = mEntries.begin(); iter != mEntries.end();) {
+            if (std::find(wanted.begin(), wanted.end(), (*iter)->position) == wanted.end()) {
+                mBytes -= (*iter)->length*(*iter)->channels.size()*sizeof(float);
+                mRetired.push_back(std::move(*iter));
+                iter = mEntries.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    for (auto position : wanted) {
+        if (mStop || mChanged) {
+            //start over with the new list
+            return true;
+        }
+
+        if (find(position)) {
+            continue;
+        }
+
+        auto entry = build(position);
+        if (!entry) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mEntryMutex);
+            mEntries.push_back(entry);
+        }
+        mBytes += entry->length*entry->channels.size()*sizeof(float);
+
+        //one per pass so a change in snapshot gets picked up quickly
+        return true;
+    }
+
+    return false;
+}
+
+SnapshotCache::EntryPtr SnapshotCache::build(sampleCount position) {
+    const size_t len = std::max<size_t>(1, sWarmSecs*mRate);
+
+    auto entry = std::make_shared<Entry>();
+    entry->position = position;
+    entry->length = len;
+
+    std::vector<SeqBlock> blocks;
+    for (auto& pSeq : mSequences) {
+        if (!pSeq) {
+            continue;
+        }
+
+        for (size_t channel = 0; channel < pSeq->NChannels(); ++channel) {
+            if (mStop) {
+                return nullptr;
+            }
+
+            std::vector<float> samples(len, 0.0f);
+
+            //blocks hold seconds of audio so a few is always enough to cover the warm length
+            blocks.clear();
+            pSeq->getUpcomingBlocks(channel, position, false, 4, blocks);
+
+            for (auto& block : blocks) {
+                const auto blockEnd = block.start + block.sb->getSampleCount();
+                const auto from = std::max(position, block.start);
+                const auto to = std::min(position + len, blockEnd);
+                if (from >= to) {
+                    continue;
+                }
+
+                block.sb->GetSamples((samplePtr)(samples.data() + (from - position).as_size_t()), floatSample,
+                                     (from - block.start).as_size_t(), (to - from).as_size_t());
+            }
+
+            entry->channels.push_back(std::move(samples));
+        }
+    }
+
+    return entry;
+}
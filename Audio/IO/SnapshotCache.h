@@ -0,0 +1,106 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef SNAPSHOTCACHE_H
+#define SNAPSHOTCACHE_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../Playback/Sequences/AudioIOSequences.h"
+
+//Keeps the start of every snapshot in memory for all the playing channels so a recall can start
+//playing from here in the very next callback while the normal stream catches up behind it.
+//The current snapshot and its neighbours are warmed first, the rest as the memory budget allows
+class SnapshotCache {
+public:
+    struct Entry {
+        sampleCount position;
+        size_t length;
+        //one per playback channel, in the same order as the playback buffers
+        std::vector<std::vector<float>> channels;
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    struct Stats {
+        size_t warm;
+        size_t bytes;
+        size_t recalls;
+        size_t warmRecalls;
+        //from the recall being asked for to audio from the snapshot going out, in ms
+        double lastRecallMs;
+        double avgRecallMs;
+        double maxRecallMs;
+    };
+
+private:
+    constPlayableSequences mSequences;
+    double mRate = 0;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCV;
+    std::atomic<bool> mStop {false};
+    std::atomic<bool> mChanged {false};
+
+    //guarded by mMutex
+    std::vector<double> mTimes;
+    int mCurrent = 0;
+
+    //the callback only ever try_locks this
+    mutable std::mutex mEntryMutex;
+    std::vector<EntryPtr> mEntries;
+    std::atomic<size_t> mBytes {0};
+
+    //evicted entries the callback might still be playing, the warm thread frees them once its the only owner so
+    //the callback never drops the last reference to megabytes of samples. Warm thread only
+    std::vector<EntryPtr> mRetired;
+
+    std::atomic<size_t> mRecalls {0};
+    std::atomic<size_t> mWarmRecalls {0};
+    std::atomic<double> mLastRecallMs {0};
+    std::atomic<double> mTotalRecallMs {0};
+    std::atomic<double> mMaxRecallMs {0};
+
+public:
+    ~SnapshotCache();
+
+    void start(const constPlayableSequences& sequences, double rate);
+    void stop();
+
+    //snapshot times in seconds, current is the one last recalled
+    void setSnapshots(const std::vector<double>& times, int current);
+
+    //safe to call from the audio callback, never waits. null when the position isnt warm (yet)
+    EntryPtr find(sampleCount position);
+
+    void noteRecall(bool warm, double ms);
+    Stats getStats() const;
+
+    //STATIC MEMBERS
+    static double sWarmSecs;
+    //snapshots either side of the current one that get warmed first
+    static int sNeighbours;
+    static size_t sMaxBytes;
+    //how often the warm thread checks if the callback has let go of a retired entry
+    static std::chrono::milliseconds sRetireCheck;
+
+private:
+    void warmThread();
+    bool warmPass();
+    void releaseRetired();
+    EntryPtr build(sampleCount position);
+};
+
+
+
+#endif //SNAPSHOTCACHE_H
@@ -0,0 +1,472 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "SampleKernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define SAMPLEKERNELS_SSE 1
+    #include <emmintrin.h>
+#endif
+
+MinMaxSumSq CalcMinMaxSumSq(const float *src, size_t len) {
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    double sumSq = 0;
+    size_t i = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    if (len >= 8) {
+        __m128 vMin0 = _mm_loadu_ps(src), vMin1 = _mm_loadu_ps(src+4);
+        __m128 vMax0 = vMin0, vMax1 = vMin1;
+        __m128 vSq0 = _mm_setzero_ps(), vSq1 = _mm_setzero_ps();
+
+        //two accumulators so the adds dont wait on each other
+        for (; i + 8 <= len; i += 8) {
+            __m128 a = _mm_loadu_ps(src+i);
+            __m128 b = _mm_loadu_ps(src+i+4);
+
+            vMin0 = _mm_min_ps(vMin0, a);
+            vMin1 = _mm_min_ps(vMin1, b);
+            vMax0 = _mm_max_ps(vMax0, a);
+            vMax1 = _mm_max_ps(vMax1, b);
+            vSq0 = _mm_add_ps(vSq0, _mm_mul_ps(a, a));
+            vSq1 = _mm_add_ps(vSq1, _mm_mul_ps(b, b));
+        }
+
+        alignas(16) float mins[4], maxs[4], sqs[4];
+        _mm_store_ps(mins, _mm_min_ps(vMin0, vMin1));
+        _mm_store_ps(maxs, _mm_max_ps(vMax0, vMax1));
+        _mm_store_ps(sqs, _mm_add_ps(vSq0, vSq1));
+
+        for (int k = 0; k < 4; ++k) {
+            min = std::min(min, mins[k]);
+            max = std::max(max, maxs[k]);
+            sumSq += sqs[k];
+        }
+    }
+#endif
+
+    //whatever is left over (or everything without sse)
+    for (; i < len; ++i) {
+        float sample = src[i];
+        min = std::min(min, sample);
+        max = std::max(max, sample);
+        sumSq += sample*sample;
+    }
+
+    return {min, max, sumSq};
+}
+
+void FillDitherNoise(uint32_t seeds[4], float *dst, size_t len) {
+    size_t i = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    __m128i x = _mm_loadu_si128((const __m128i*)seeds);
+    const __m128i one = _mm_set1_epi32(0x3f800000);
+    const __m128 half = _mm_set1_ps(1.5f);
+
+    for (; i + 4 <= len; i += 4) {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+
+        //top 23 bits as the mantissa of a float in [1, 2)
+        __m128 f = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(x, 9), one));
+        _mm_storeu_ps(dst+i, _mm_sub_ps(f, half));
+    }
+    _mm_storeu_si128((__m128i*)seeds, x);
+#endif
+
+    //same lanes in the same order so the output doesnt depend on having sse
+    for (; i < len; ++i) {
+        auto& x = seeds[i & 3];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        uint32_t bits = (x >> 9) | 0x3f800000;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        dst[i] = f - 1.5f;
+    }
+}
+
+void QuantizeToInt16(const float *src, const float *noise, short *dst, size_t len) {
+    constexpr float scale = 32768.0f, lo = -32768.0f, hi = 32767.0f;
+    size_t i = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    const __m128 vScale = _mm_set1_ps(scale), vLo = _mm_set1_ps(lo), vHi = _mm_set1_ps(hi);
+    for (; i + 8 <= len; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src+i), vScale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src+i+4), vScale);
+        if (noise) {
+            a = _mm_add_ps(a, _mm_loadu_ps(noise+i));
+            b = _mm_add_ps(b, _mm_loadu_ps(noise+i+4));
+        }
+        a = _mm_min_ps(_mm_max_ps(a, vLo), vHi);
+        b = _mm_min_ps(_mm_max_ps(b, vLo), vHi);
+
+        //cvtps rounds to nearest like lrintf
+        _mm_storeu_si128((__m128i*)(dst+i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+#endif
+
+    for (; i < len; ++i) {
+        float v = src[i]*scale + (noise ? noise[i] : 0.0f);
+        dst[i] = (short)lrintf(std::clamp(v, lo, hi));
+    }
+}
+
+void QuantizeToInt24(const float *src, const float *noise, int *dst, size_t len) {
+    constexpr float scale = 8388608.0f, lo = -8388608.0f, hi = 8388607.0f;
+    size_t i = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    const __m128 vScale = _mm_set1_ps(scale), vLo = _mm_set1_ps(lo), vHi = _mm_set1_ps(hi);
+    for (; i + 4 <= len; i += 4) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src+i), vScale);
+        if (noise) {
+            a = _mm_add_ps(a, _mm_loadu_ps(noise+i));
+        }
+        a = _mm_min_ps(_mm_max_ps(a, vLo), vHi);
+        _mm_storeu_si128((__m128i*)(dst+i), _mm_cvtps_epi32(a));
+    }
+#endif
+
+    for (; i < len; ++i) {
+        float v = src[i]*scale + (noise ? noise[i] : 0.0f);
+        dst[i] = (int)lrintf(std::clamp(v, lo, hi));
+    }
+}
+
+void InterleaveFloats(const float *const *src, size_t channels, size_t len, float *dst) {
+    if (channels == 1) {
+        memcpy(dst, src[0], len*sizeof(float));
+        return;
+    }
+
+    size_t j = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    if (channels == 2) {
+        for (; j + 4 <= len; j += 4) {
+            __m128 l = _mm_loadu_ps(src[0]+j);
+            __m128 r = _mm_loadu_ps(src[1]+j);
+            _mm_storeu_ps(dst + 2*j, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dst + 2*j + 4, _mm_unpackhi_ps(l, r));
+        }
+    } else if (channels >= 4) {
+        //4 frames x 4 channels at a time, a transpose turns channel rows into frame rows
+        const size_t tiled = channels/4*4;
+        for (; j + 4 <= len; j += 4) {
+            float* out = dst + channels*j;
+            for (size_t c = 0; c < tiled; c += 4) {
+                __m128 r0 = _mm_loadu_ps(src[c]+j);
+                __m128 r1 = _mm_loadu_ps(src[c+1]+j);
+                __m128 r2 = _mm_loadu_ps(src[c+2]+j);
+                __m128 r3 = _mm_loadu_ps(src[c+3]+j);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(out + c, r0);
+                _mm_storeu_ps(out + channels + c, r1);
+                _mm_storeu_ps(out + 2*channels + c, r2);
+                _mm_storeu_ps(out + 3*channels + c, r3);
+            }
+            for (size_t c = tiled; c < channels; ++c) {
+                for (size_t k = 0; k < 4; ++k) {
+                    out[k*channels + c] = src[c][j+k];
+                }
+            }
+        }
+    }
+#endif
+
+    for (; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            dst[channels*j + c] = src[c][j];
+        }
+    }
+}
+
+void InterleaveInt16(const short *const *src, size_t channels, size_t len, short *dst) {
+    if (channels == 1) {
+        memcpy(dst, src[0], len*sizeof(short));
+        return;
+    }
+
+    size_t j = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    if (channels == 2) {
+        for (; j + 8 <= len; j += 8) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(src[0]+j));
+            __m128i r = _mm_loadu_si128((const __m128i*)(src[1]+j));
+            _mm_storeu_si128((__m128i*)(dst + 2*j), _mm_unpacklo_epi16(l, r));
+            _mm_storeu_si128((__m128i*)(dst + 2*j + 8), _mm_unpackhi_epi16(l, r));
+        }
+    } else if (channels >= 4) {
+        //same 4x4 tiles as the float version, done with 16 then 32 bit unpacks
+        const size_t tiled = channels/4*4;
+        for (; j + 4 <= len; j += 4) {
+            short* out = dst + channels*j;
+            for (size_t c = 0; c < tiled; c += 4) {
+                __m128i ab = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(src[c]+j)), _mm_loadl_epi64((const __m128i*)(src[c+1]+j)));
+                __m128i cd = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(src[c+2]+j)), _mm_loadl_epi64((const __m128i*)(src[c+3]+j)));
+                __m128i lo = _mm_unpacklo_epi32(ab, cd);
+                __m128i hi = _mm_unpackhi_epi32(ab, cd);
+                _mm_storel_epi64((__m128i*)(out + c), lo);
+                _mm_storel_epi64((__m128i*)(out + channels + c), _mm_srli_si128(lo, 8));
+                _mm_storel_epi64((__m128i*)(out + 2*channels + c), hi);
+                _mm_storel_epi64((__m128i*)(out + 3*channels + c), _mm_srli_si128(hi, 8));
+            }
+            for (size_t c = tiled; c < channels; ++c) {
+                for (size_t k = 0; k < 4; ++k) {
+                    out[k*channels + c] = src[c][j+k];
+                }
+            }
+        }
+    }
+#endif
+
+    for (; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            dst[channels*j + c] = src[c][j];
+        }
+    }
+}
+
+void InterleaveInt24(const int *const *src, size_t channels, size_t len, unsigned char *dst) {
+    for (size_t j = 0; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            const int v = src[c][j];
+            dst[0] = v & 0xff;
+            dst[1] = (v >> 8) & 0xff;
+            dst[2] = (v >> 16) & 0xff;
+            dst += 3;
+        }
+    }
+}
+
+void DeinterleaveFloats(const float *src, size_t channels, size_t len, float *const *dst) {
+    if (channels == 1) {
+        memcpy(dst[0], src, len*sizeof(float));
+        return;
+    }
+
+    size_t j = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    if (channels >= 4) {
+        //4x4 tiles like the interleave, frame rows in and channel rows out
+        const size_t tiled = channels/4*4;
+        for (; j + 4 <= len; j += 4) {
+            const float* in = src + channels*j;
+            for (size_t c = 0; c < tiled; c += 4) {
+                __m128 r0 = _mm_loadu_ps(in + c);
+                __m128 r1 = _mm_loadu_ps(in + channels + c);
+                __m128 r2 = _mm_loadu_ps(in + 2*channels + c);
+                __m128 r3 = _mm_loadu_ps(in + 3*channels + c);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(dst[c]+j, r0);
+                _mm_storeu_ps(dst[c+1]+j, r1);
+                _mm_storeu_ps(dst[c+2]+j, r2);
+                _mm_storeu_ps(dst[c+3]+j, r3);
+            }
+            for (size_t c = tiled; c < channels; ++c) {
+                for (size_t k = 0; k < 4; ++k) {
+                    dst[c][j+k] = in[k*channels + c];
+                }
+            }
+        }
+    }
+#endif
+
+    for (; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            dst[c][j] = src[channels*j + c];
+        }
+    }
+}
+
+void DeinterleaveInt16(const short *src, size_t channels, size_t len, float *const *dst) {
+    constexpr float scale = 1.0f/32768.0f;
+    size_t j = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    if (channels >= 4) {
+        const size_t tiled = channels/4*4;
+        const __m128 vScale = _mm_set1_ps(scale);
+        //4 channels of one frame, sign extended to 32 bits and scaled
+        auto loadFrame = [&](const short* in) {
+            __m128i s = _mm_loadl_epi64((const __m128i*)in);
+            return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), vScale);
+        };
+
+        for (; j + 4 <= len; j += 4) {
+            const short* in = src + channels*j;
+            for (size_t c = 0; c < tiled; c += 4) {
+                __m128 r0 = loadFrame(in + c);
+                __m128 r1 = loadFrame(in + channels + c);
+                __m128 r2 = loadFrame(in + 2*channels + c);
+                __m128 r3 = loadFrame(in + 3*channels + c);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(dst[c]+j, r0);
+                _mm_storeu_ps(dst[c+1]+j, r1);
+                _mm_storeu_ps(dst[c+2]+j, r2);
+                _mm_storeu_ps(dst[c+3]+j, r3);
+            }
+            for (size_t c = tiled; c < channels; ++c) {
+                for (size_t k = 0; k < 4; ++k) {
+                    dst[c][j+k] = in[k*channels + c]*scale;
+                }
+            }
+        }
+    }
+#endif
+
+    for (; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            dst[c][j] = src[channels*j + c]*scale;
+        }
+    }
+}
+
+void DeinterleaveInt24(const unsigned char *src, size_t channels, size_t len, float *const *dst) {
+    constexpr float scale = 1.0f/8388608.0f;
+    //3 byte samples dont line up with anything sse loads, this is bound by the byte shuffling either way
+    for (size_t j = 0; j < len; ++j) {
+        for (size_t c = 0; c < channels; ++c) {
+            //into the top of an int so the shift back down sign extends
+            const int v = (int)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24) >> 8;
+            dst[c][j] = v*scale;
+            src += 3;
+        }
+    }
+}
+
+void MixAccumulate(const float *src, float gain, float *dst, size_t len) {
+    size_t i = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    const __m128 vGain = _mm_set1_ps(gain);
+    for (; i + 8 <= len; i += 8) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(dst+i), _mm_mul_ps(_mm_loadu_ps(src+i), vGain));
+        __m128 b = _mm_add_ps(_mm_loadu_ps(dst+i+4), _mm_mul_ps(_mm_loadu_ps(src+i+4), vGain));
+        _mm_storeu_ps(dst+i, a);
+        _mm_storeu_ps(dst+i+4, b);
+    }
+#endif
+
+    //separate mul and add, not fma, so the result doesnt depend on having sse
+    for (; i < len; ++i) {
+        float scaled = src[i]*gain;
+        dst[i] += scaled;
+    }
+}
+
+namespace {
+#ifdef SAMPLEKERNELS_SSE
+    //Groups lots of 4 channels, 4 groups is a whole cache line of a float frame so each pass only reads its own lines
+    template<int Groups, typename Load>
+    void measureGroups(size_t channels, size_t len, size_t c, float clipLevel, float* peaks, float* sumSqs, uint32_t* clips, Load load) {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 vClip = _mm_set1_ps(clipLevel);
+
+        __m128 vPeak[Groups], vSq[Groups];
+        __m128i vClips[Groups];
+        for (int g = 0; g < Groups; ++g) {
+            vPeak[g] = _mm_setzero_ps();
+            vSq[g] = _mm_setzero_ps();
+            vClips[g] = _mm_setzero_si128();
+        }
+
+        for (size_t f = 0; f < len; ++f) {
+            for (int g = 0; g < Groups; ++g) {
+                __m128 x = load(f*channels + c + g*4);
+                __m128 a = _mm_andnot_ps(sign, x);
+
+                vPeak[g] = _mm_max_ps(vPeak[g], a);
+                vSq[g] = _mm_add_ps(vSq[g], _mm_mul_ps(x, x));
+                //the compare is all ones (-1) in the lanes at or over the clip level
+                vClips[g] = _mm_sub_epi32(vClips[g], _mm_castps_si128(_mm_cmpge_ps(a, vClip)));
+            }
+        }
+
+        for (int g = 0; g < Groups; ++g) {
+            _mm_storeu_ps(peaks + c + g*4, vPeak[g]);
+            _mm_storeu_ps(sumSqs + c + g*4, vSq[g]);
+            _mm_storeu_si128((__m128i*)(clips + c + g*4), vClips[g]);
+        }
+    }
+#endif
+
+    template<typename Sample, typename ToFloat>
+    void measureScalar(const Sample* src, size_t channels, size_t len, size_t c, float clipLevel, float* peaks, float* sumSqs, uint32_t* clips, ToFloat toFloat) {
+        for (; c < channels; ++c) {
+            float peak = 0;
+            float sumSq = 0;
+            uint32_t clipped = 0;
+
+            for (size_t f = 0; f < len; ++f) {
+                float x = toFloat(src[f*channels + c]);
+                float a = std::fabs(x);
+
+                peak = std::max(peak, a);
+                sumSq += x*x;
+                clipped += a >= clipLevel;
+            }
+
+            peaks[c] = peak;
+            sumSqs[c] = sumSq;
+            clips[c] = clipped;
+        }
+    }
+}
+
+void MeasureInterleaved(const float *src, size_t channels, size_t len, float clipLevel, float *peaks, float *sumSqs, uint32_t *clips) {
+    size_t c = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    auto load = [src](size_t i) {return _mm_loadu_ps(src+i);};
+    for (; c + 16 <= channels; c += 16) {
+        measureGroups<4>(channels, len, c, clipLevel, peaks, sumSqs, clips, load);
+    }
+    for (; c + 4 <= channels; c += 4) {
+        measureGroups<1>(channels, len, c, clipLevel, peaks, sumSqs, clips, load);
+    }
+#endif
+
+    measureScalar(src, channels, len, c, clipLevel, peaks, sumSqs, clips, [](float s) {return s;});
+}
+
+void MeasureInterleavedInt16(const short *src, size_t channels, size_t len, float clipLevel, float *peaks, float *sumSqs, uint32_t *clips) {
+    constexpr float scale = 1.0f/32768.0f;
+    size_t c = 0;
+
+#ifdef SAMPLEKERNELS_SSE
+    const __m128 vScale = _mm_set1_ps(scale);
+    auto load = [src, vScale](size_t i) {
+        //4 shorts into the top of each lane then shifted back down to sign extend them
+        __m128i x = _mm_loadl_epi64((const __m128i*)(src+i));
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), vScale);
+    };
+    for (; c + 16 <= channels; c += 16) {
+        measureGroups<4>(channels, len, c, clipLevel, peaks, sumSqs, clips, load);
+    }
+    for (; c + 4 <= channels; c += 4) {
+        measureGroups<1>(channels, len, c, clipLevel, peaks, sumSqs, clips, load);
+    }
+#endif
+
+    measureScalar(src, channels, len, c, clipLevel, peaks, sumSqs, clips, [scale](short s) {return s*scale;});
+}
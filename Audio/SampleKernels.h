@@ -0,0 +1,52 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef SAMPLEKERNELS_H
+#define SAMPLEKERNELS_H
+#include <cstddef>
+#include <cstdint>
+
+//Small hot loops over float samples. Uses SSE when the compiler targets it, otherwise plain loops.
+
+struct MinMaxSumSq {
+    float min;
+    float max;
+    double sumSq;
+};
+
+//min, max and sum of squares of len samples, len == 0 gives {FLT_MAX, -FLT_MAX, 0}
+MinMaxSumSq CalcMinMaxSumSq(const float* src, size_t len);
+
+//uniform noise in [-0.5, 0.5), seeds are 4 xorshift generators (one per lane) and get moved on
+void FillDitherNoise(uint32_t seeds[4], float* dst, size_t len);
+
+//round(src*full scale + noise) clamped to the format's range, noise can be null
+void QuantizeToInt16(const float* src, const float* noise, short* dst, size_t len);
+void QuantizeToInt24(const float* src, const float* noise, int* dst, size_t len);
+
+//channels one after the other in dst, int24 gets packed down to 3 bytes a sample like wav files want
+void InterleaveFloats(const float* const* src, size_t channels, size_t len, float* dst);
+void InterleaveInt16(const short* const* src, size_t channels, size_t len, short* dst);
+void InterleaveInt24(const int* const* src, size_t channels, size_t len, unsigned char* dst);
+
+//the other way, interleaved file samples out to one float buffer per channel. int24 is packed 3 bytes a sample
+void DeinterleaveFloats(const float* src, size_t channels, size_t len, float* const* dst);
+void DeinterleaveInt16(const short* src, size_t channels, size_t len, float* const* dst);
+void DeinterleaveInt24(const unsigned char* src, size_t channels, size_t len, float* const* dst);
+
+//dst += src*gain
+void MixAccumulate(const float* src, float gain, float* dst, size_t len);
+
+//levels of each channel of len interleaved frames, for metering. peaks are absolute, clips counts the samples at or
+//over clipLevel. peaks, sumSqs and clips need an entry per channel and get overwritten
+void MeasureInterleaved(const float* src, size_t channels, size_t len, float clipLevel, float* peaks, float* sumSqs, uint32_t* clips);
+void MeasureInterleavedInt16(const short* src, size_t channels, size_t len, float clipLevel, float* peaks, float* sumSqs, uint32_t* clips);
+
+
+
+#endif //SAMPLEKERNELS_H
@@ -32,6 +32,8 @@ public:
     audioBuffer(SampleFormat format, size_t size);
     ~audioBuffer();
 
+    size_t size() const {return mBufferSize;}
+
     //for the writer only
     size_t availForPut() const;
     size_t writtenForGet() const;
@@ -0,0 +1,306 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+//Builds a synthetic session and times the export paths on it: one track on its own, every track as a stem
+//with more and more of them going at once (up to the number of cores) and every track in one polyphonic file.
+//Each run prints the throughput, how long each pipeline stage spent working and the peak memory on top of
+//what the session already used, so runs from different versions can be compared line for line.
+//
+//usage: ExportBenchmark [tracks] [seconds] [bits]
+//  tracks   number of mono tracks in the session (default 16)
+//  seconds  length of every track (default 60)
+//  bits     32 (float), 24 or 16 (default 32)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../Audio/IO/AudioIO.h"
+#include "../Playback/Track.h"
+#include "../Saving/DBConnection.h"
+#include "../Saving/Exporter.h"
+#include "../Saving/File Types/WavFile.h"
+#include "../Threading/ThreadPool.h"
+
+#if defined _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace {
+    constexpr double kRate = 48000;
+    constexpr size_t kAppendLen = 4096;
+
+    const char* kBenchDir = "./tmp/bench/";
+
+    //sine + a bit of noise per track so blocks arent trivially compressible by the os
+    void fillSignal(vector<float>& buffer, size_t track, size_t start, mt19937& rng) {
+        uniform_real_distribution<float> noise(-0.05f, 0.05f);
+        double freq = 110.0*(track+1);
+        for (size_t i = 0; i < buffer.size(); ++i) {
+            buffer[i] = 0.5f*(float)sin(2*M_PI*freq*(start+i)/kRate) + noise(rng);
+        }
+    }
+
+    shared_ptr<DBConnection> openSession(const string& path) {
+        filesystem::remove(path);
+        filesystem::remove(path+"-wal");
+        filesystem::remove(path+"-shm");
+
+        auto db = make_shared<DBConnection>();
+        if (db->open(path.c_str(), true) != SQLITE_OK) {
+            cerr<<"Failed to open benchmark db"<<endl;
+            return nullptr;
+        }
+
+        const char * sql = "CREATE TABLE IF NOT EXISTS sampleBlocks ( "
+                           "blockID INTEGER PRIMARY KEY, "
+                           "sampleformat INTEGER, "
+                           "summin REAL, "
+                           "summax REAL, "
+                           "sumrms REAL, "
+                           "samples BLOB,"
+                           "summary256 BLOB,"
+                           "summary64k BLOB);";
+        sqlite3_exec(db->DB(), sql, nullptr, nullptr, nullptr);
+
+        sql = "CREATE TABLE IF NOT EXISTS sampleSummaries ( "
+              "blockID INTEGER PRIMARY KEY, "
+              "summin REAL, "
+              "summax REAL, "
+              "sumrms REAL, "
+              "summary256 BLOB,"
+              "summary64k BLOB);";
+        sqlite3_exec(db->DB(), sql, nullptr, nullptr, nullptr);
+
+        return db;
+    }
+
+    //records the tracks the same way AudioIO does, small appends that get flushed into blocks
+    Tracks buildTracks(size_t numTracks, double seconds) {
+        Tracks tracks;
+        const size_t totalSamples = (size_t)(seconds*kRate);
+
+        mt19937 rng(1234);
+        vector<float> buffer(kAppendLen);
+
+        for (size_t t = 0; t < numTracks; ++t) {
+            auto track = make_shared<Track>(kRate, floatSample, t+1);
+            for (size_t pos = 0; pos < totalSamples; pos += kAppendLen) {
+                buffer.resize(std::min(kAppendLen, totalSamples - pos));
+                fillSignal(buffer, t, pos, rng);
+                track->append(0, (constSamplePtr)buffer.data(), floatSample, buffer.size(), 1, floatSample);
+            }
+            track->Flush();
+            tracks.push_back(track);
+        }
+
+        return tracks;
+    }
+
+    //resident memory right now, 0 where we dont know how to ask
+    size_t currentMemory() {
+#if defined _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.WorkingSetSize;
+        }
+        return 0;
+#elif defined __linux__
+        size_t pages = 0, resident = 0;
+        if (FILE* statm = fopen("/proc/self/statm", "r")) {
+            if (fscanf(statm, "%zu %zu", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            fclose(statm);
+        }
+        return resident*sysconf(_SC_PAGESIZE);
+#else
+        return 0;
+#endif
+    }
+
+    //samples the memory use while a run goes, the os peak counters cant be reset between runs
+    class PeakMemory {
+        std::atomic<bool> mStop {false};
+        std::atomic<size_t> mPeak {0};
+        size_t mBase;
+        std::thread mThread;
+
+    public:
+        PeakMemory() : mBase(currentMemory()) {
+            mThread = thread([this] {
+                while (!mStop) {
+                    mPeak = std::max(mPeak.load(), currentMemory());
+                    this_thread::sleep_for(chrono::milliseconds(5));
+                }
+            });
+        }
+
+        //bytes over what was in use when it started
+        size_t stop() {
+            mStop = true;
+            mThread.join();
+            mPeak = std::max(mPeak.load(), currentMemory());
+            return mPeak > mBase ? mPeak - mBase : 0;
+        }
+    };
+
+    size_t dirSize(const string& dir) {
+        size_t size = 0;
+        error_code ec;
+        for (auto& entry : filesystem::directory_iterator(dir, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+                size += entry.file_size();
+            }
+        }
+        return size;
+    }
+
+    void removeStems(const string& dir) {
+        error_code ec;
+        for (auto& entry : filesystem::directory_iterator(dir, ec)) {
+            if (entry.path().extension() == ".wav") {
+                filesystem::remove(entry.path());
+            }
+        }
+    }
+}
+
+struct RunResult {
+    double secs = 0;
+    double mb = 0;
+    ExportStageTimes stages;
+    size_t peakBytes = 0;
+};
+
+//runs one export and measures it, the output files get deleted after
+template<typename F>
+RunResult timeExport(Exporter& exporter, F&& run) {
+    RunResult result;
+    exporter.resetStageTimes();
+
+    PeakMemory peak;
+    auto start = Clock::now();
+    run();
+    result.secs = chrono::duration<double>(Clock::now() - start).count();
+    result.peakBytes = peak.stop();
+
+    result.stages = exporter.getStageTimes();
+    result.mb = dirSize(kBenchDir)/(1024.0*1024.0);
+    removeStems(kBenchDir);
+
+    return result;
+}
+
+void printResult(const string& mode, size_t concurrent, size_t tracksWritten, double seconds, const RunResult& result) {
+    const double secs = std::max(result.secs, 1e-9);
+    cout<<left<<setw(8)<<mode<<right<<setw(6)<<concurrent<<setw(9)<<result.secs<<setw(12)<<tracksWritten*seconds/secs
+        <<setw(9)<<result.mb/secs<<setw(9)<<result.stages.read<<setw(9)<<result.stages.convert<<setw(9)<<result.stages.write
+        <<setw(10)<<result.peakBytes/(1024.0*1024.0)<<endl;
+}
+
+int main(int argc, char** argv) {
+    size_t numTracks = 16;
+    double seconds = 60;
+    SampleFormat format = floatSample;
+
+    if (argc > 1) {
+        numTracks = std::max(1, atoi(argv[1]));
+    }
+    if (argc > 2) {
+        seconds = std::max(1.0, atof(argv[2]));
+    }
+    if (argc > 3) {
+        int bits = atoi(argv[3]);
+        format = bits == 16 ? int16Sample : bits == 24 ? int24Sample : floatSample;
+    }
+
+    filesystem::create_directories(kBenchDir);
+
+    string dbPath = kBenchDir;
+    dbPath += "export.bench";
+
+    auto db = openSession(dbPath);
+    if (!db) {
+        return 1;
+    }
+    AudioIOBase::sAudioDB = db;
+
+    cout<<"Export benchmark: "<<numTracks<<" tracks, "<<seconds<<"s each, "<<WavFile::BytesPerSample(format)*8<<" bit, "
+        <<ThreadPool::Get().size()<<" threads"<<endl;
+
+    auto buildStart = Clock::now();
+    auto tracks = buildTracks(numTracks, seconds);
+    cout<<"session built in "<<chrono::duration<double>(Clock::now() - buildStart).count()<<"s"<<endl;
+
+    const sampleCount end = sampleCount(seconds*kRate);
+    const string dir = kBenchDir;
+
+    //stage times are summed over every file so with more than one going at once they add up to more than secs
+    cout<<left<<setw(8)<<"mode"<<right<<setw(6)<<"conc"<<setw(9)<<"secs"<<setw(12)<<"x realtime"<<setw(9)<<"MB/s"
+        <<setw(9)<<"read"<<setw(9)<<"convert"<<setw(9)<<"write"<<setw(10)<<"peak MB"<<endl;
+    cout<<fixed<<setprecision(2);
+
+    Exporter exporter;
+    exporter.setShowProgress(false);
+    exporter.setExportFormat(format);
+
+    //one track on its own, the baseline for the pipeline
+    Exporter::setMaxConcurrentExports(1);
+    auto single = timeExport(exporter, [&] {
+        exporter.exportWavSamples(dir + "single.wav", {tracks[0]}, 0, end);
+    });
+    printResult("single", 1, 1, seconds, single);
+
+    //every track as a stem, more at once each run
+    const size_t maxConcurrent = std::max<size_t>(ThreadPool::Get().size(), 1);
+    for (size_t concurrent = 1; ; concurrent = std::min(concurrent*2, maxConcurrent)) {
+        Exporter::setMaxConcurrentExports(concurrent);
+
+        //more than one track gets " - n.wav" added on by the exporter
+        auto stems = timeExport(exporter, [&] {
+            exporter.exportWavSamples(dir + (numTracks > 1 ? "stem" : "stem.wav"), tracks, 0, end);
+        });
+        printResult("stems", concurrent, numTracks, seconds, stems);
+
+        if (concurrent == maxConcurrent) {
+            break;
+        }
+    }
+
+    //every track in one file
+    auto poly = timeExport(exporter, [&] {
+        exporter.exportPolyWav(dir + "poly.wav", tracks, 0, end);
+    });
+    printResult("poly", 1, numTracks, seconds, poly);
+
+    tracks.clear();
+    db->close();
+    AudioIOBase::sAudioDB.reset();
+
+    filesystem::remove(dbPath);
+    filesystem::remove(dbPath+"-wal");
+    filesystem::remove(dbPath+"-shm");
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+//Sweeps the storage settings (page size, synchronous, journal mode, mmap, block size) over a
+//recording like workload and prints how each one does.
+//
+//usage: StorageBenchmark [channels] [seconds] [--full] [--inline]
+//  channels  number of tracks recorded at once (default 32)
+//  seconds   length of audio per channel (default 30)
+//  --full    run every combination instead of changing one setting at a time
+//  --inline  work the summaries out as blocks are saved instead of deferring them to the SummaryWorker
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Audio/AudioData/SqliteSampleBlock.h"
+#include "../Audio/AudioData/SummaryWorker.h"
+#include "../Audio/IO/AudioIO.h"
+#include "../Saving/DBConnection.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace {
+    constexpr double kRate = 48000;
+    constexpr size_t kReadLen = 4096;
+    constexpr size_t kReadsPerRun = 2000;
+
+    const char* kBenchDir = "./tmp/bench/";
+
+    struct Result {
+        StorageProfile profile;
+        double insertsPerSec = 0;
+        double writeMBs = 0;
+        //deferred only, how long the SummaryWorker took to catch up once the last block was saved
+        double summaryFillSecs = 0;
+        double readP50 = 0, readP95 = 0, readP99 = 0;
+        double summaryP50 = 0, summaryP99 = 0;
+        double dbMB = 0;
+    };
+
+    double percentile(vector<double>& values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        auto ndx = std::min(values.size()-1, (size_t)(p*(values.size()-1)));
+        std::nth_element(values.begin(), values.begin()+ndx, values.end());
+        return values[ndx];
+    }
+
+    //sine + a bit of noise per channel so blocks arent trivially compressible by the os
+    void fillSignal(vector<float>& buffer, size_t channel, size_t start, mt19937& rng) {
+        uniform_real_distribution<float> noise(-0.05f, 0.05f);
+        double freq = 110.0*(channel+1);
+        for (size_t i = 0; i < buffer.size(); ++i) {
+            buffer[i] = 0.5f*(float)sin(2*M_PI*freq*(start+i)/kRate) + noise(rng);
+        }
+    }
+
+    size_t fileSize(const string& path) {
+        error_code ec;
+        auto size = filesystem::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+
+    Result runProfile(const StorageProfile& profile, size_t channels, double seconds) {
+        Result result;
+        result.profile = profile;
+
+        string path = kBenchDir;
+        path += "storage.bench";
+        filesystem::remove(path);
+        filesystem::remove(path+"-wal");
+        filesystem::remove(path+"-shm");
+
+        DBConnection::setSafeProfile(profile);
+
+        auto db = make_shared<DBConnection>();
+        if (db->open(path.c_str(), true) != SQLITE_OK) {
+            cerr<<"Failed to open benchmark db"<<endl;
+            return result;
+        }
+        AudioIOBase::sAudioDB = db;
+
+        const char * sql = "CREATE TABLE IF NOT EXISTS sampleBlocks ( "
+                           "blockID INTEGER PRIMARY KEY, "
+                           "sampleformat INTEGER, "
+                           "summin REAL, "
+                           "summax REAL, "
+                           "sumrms REAL, "
+                           "samples BLOB,"
+                           "summary256 BLOB,"
+                           "summary64k BLOB);";
+        sqlite3_exec(db->DB(), sql, nullptr, nullptr, nullptr);
+
+        sql = "CREATE TABLE IF NOT EXISTS sampleSummaries ( "
+              "blockID INTEGER PRIMARY KEY, "
+              "summin REAL, "
+              "summax REAL, "
+              "sumrms REAL, "
+              "summary256 BLOB,"
+              "summary64k BLOB);";
+        sqlite3_exec(db->DB(), sql, nullptr, nullptr, nullptr);
+
+        //one factory per channel like one per sequence in a real session
+        vector<shared_ptr<SqliteSampleBlockFactory>> factories;
+        for (size_t c = 0; c < channels; ++c) {
+            factories.push_back(make_shared<SqliteSampleBlockFactory>());
+        }
+
+        const size_t blockSamples = profile.blockBytes/SAMPLE_SIZE(floatSample);
+        const size_t totalSamples = (size_t)(seconds*kRate);
+        const size_t blocksPerChannel = (totalSamples+blockSamples-1)/blockSamples;
+
+        mt19937 rng(1234);
+        vector<float> buffer(blockSamples);
+        vector<SampleBlockPtr> blocks;
+        blocks.reserve(blocksPerChannel*channels);
+
+        //WRITE, interleaved across channels the same way recording flushes them
+        double writeSecs = 0;
+        size_t bytesWritten = 0;
+        for (size_t b = 0; b < blocksPerChannel; ++b) {
+            size_t len = std::min(blockSamples, totalSamples - b*blockSamples);
+            buffer.resize(len);
+            for (size_t c = 0; c < channels; ++c) {
+                fillSignal(buffer, c, b*blockSamples, rng);
+
+                auto start = Clock::now();
+                blocks.push_back(factories[c]->Create((constSamplePtr)buffer.data(), floatSample, len));
+                writeSecs += chrono::duration<double>(Clock::now() - start).count();
+
+                bytesWritten += len*SAMPLE_SIZE(floatSample);
+            }
+        }
+
+        result.insertsPerSec = blocks.size()/writeSecs;
+        result.writeMBs = bytesWritten/(1024.0*1024.0)/writeSecs;
+
+        //otherwise the summary reads below would be filling them in inline
+        auto drainStart = Clock::now();
+        SummaryWorker::Get().Drain();
+        result.summaryFillSecs = chrono::duration<double>(Clock::now() - drainStart).count();
+
+        //READ, random windows like playback seeking around a session
+        uniform_int_distribution<size_t> pickBlock(0, blocks.size()-1);
+        vector<float> readBuffer(kReadLen);
+        vector<double> readLatency, summaryLatency;
+        readLatency.reserve(kReadsPerRun);
+        summaryLatency.reserve(kReadsPerRun);
+
+        for (size_t i = 0; i < kReadsPerRun; ++i) {
+            auto& block = blocks[pickBlock(rng)];
+            auto count = block->getSampleCount();
+            size_t offset = count > kReadLen ? uniform_int_distribution<size_t>(0, count-kReadLen)(rng) : 0;
+
+            auto start = Clock::now();
+            block->GetSamples((samplePtr)readBuffer.data(), floatSample, offset, std::min(kReadLen, count));
+            readLatency.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+
+            size_t frames = (count+255)/256;
+            vector<float> summary(frames*3);
+            start = Clock::now();
+            block->GetSummary256(summary.data(), 0, frames);
+            summaryLatency.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+        }
+
+        result.readP50 = percentile(readLatency, 0.50);
+        result.readP95 = percentile(readLatency, 0.95);
+        result.readP99 = percentile(readLatency, 0.99);
+        result.summaryP50 = percentile(summaryLatency, 0.50);
+        result.summaryP99 = percentile(summaryLatency, 0.99);
+
+        blocks.clear();
+        factories.clear();
+        db->close();
+        AudioIOBase::sAudioDB.reset();
+
+        result.dbMB = (fileSize(path) + fileSize(path+"-wal"))/(1024.0*1024.0);
+
+        filesystem::remove(path);
+        filesystem::remove(path+"-wal");
+        filesystem::remove(path+"-shm");
+
+        return result;
+    }
+
+    //cache_size is pages when positive and KiB when negative
+    double cacheMB(const StorageProfile& profile) {
+        return profile.cacheSize < 0 ? -profile.cacheSize/1024.0 : double(profile.cacheSize)*profile.pageSize/(1024*1024);
+    }
+
+    vector<StorageProfile> buildSweep(bool full) {
+        const vector<int> pageSizes = {4096, 16384, 65536};
+        const vector<string> syncModes = {"OFF", "NORMAL", "FULL"};
+        const vector<string> journalModes = {"WAL", "OFF"};
+        const vector<size_t> mmapSizes = {0, 256*1024*1024};
+        const vector<int> cacheSizes = {-2000, -64*1024};
+        const vector<size_t> blockSizes = {256*1024, 1024*1024, 4*1024*1024};
+
+        vector<StorageProfile> profiles;
+        const auto base = StorageProfile::Safe();
+
+        if (full) {
+            for (auto page : pageSizes)
+                for (auto& sync : syncModes)
+                    for (auto& journal : journalModes)
+                        for (auto mmap : mmapSizes)
+                            for (auto cache : cacheSizes)
+                                for (auto block : blockSizes) {
+                                    StorageProfile p = base;
+                                    p.pageSize = page;
+                                    p.synchronous = sync;
+                                    p.journalMode = journal;
+                                    p.mmapSize = mmap;
+                                    p.cacheSize = cache;
+                                    p.blockBytes = block;
+                                    profiles.push_back(p);
+                                }
+            return profiles;
+        }
+
+        //change one setting at a time from the current defaults
+        profiles.push_back(base);
+        for (auto page : pageSizes) {
+            if (page == base.pageSize) continue;
+            auto p = base; p.pageSize = page; profiles.push_back(p);
+        }
+        for (auto& sync : syncModes) {
+            if (sync == base.synchronous) continue;
+            auto p = base; p.synchronous = sync; profiles.push_back(p);
+        }
+        for (auto& journal : journalModes) {
+            if (journal == base.journalMode) continue;
+            auto p = base; p.journalMode = journal; profiles.push_back(p);
+        }
+        for (auto mmap : mmapSizes) {
+            if (mmap == base.mmapSize) continue;
+            auto p = base; p.mmapSize = mmap; profiles.push_back(p);
+        }
+        for (auto cache : cacheSizes) {
+            if (cache == base.cacheSize) continue;
+            auto p = base; p.cacheSize = cache; profiles.push_back(p);
+        }
+        for (auto block : blockSizes) {
+            if (block == base.blockBytes) continue;
+            auto p = base; p.blockBytes = block; profiles.push_back(p);
+        }
+
+        return profiles;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t channels = 32;
+    double seconds = 30;
+    bool full = false;
+    bool deferred = true;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--full") == 0) {
+            full = true;
+        } else if (strcmp(argv[i], "--inline") == 0) {
+            deferred = false;
+        } else if (positional++ == 0) {
+            channels = std::max(1, atoi(argv[i]));
+        } else {
+            seconds = std::max(1.0, atof(argv[i]));
+        }
+    }
+
+    filesystem::create_directories(kBenchDir);
+    SqliteSampleBlock::setDeferSummaries(deferred);
+
+    auto profiles = buildSweep(full);
+
+    cout<<"Storage benchmark: "<<channels<<" channels, "<<seconds<<"s each, "<<profiles.size()<<" configurations, "
+        <<(deferred ? "deferred" : "inline")<<" summaries"<<endl;
+    cout<<left
+        <<setw(7)<<"page"<<setw(8)<<"sync"<<setw(6)<<"jrnl"<<setw(7)<<"mmapMB"<<setw(8)<<"cacheMB"<<setw(8)<<"blockKB"
+        <<right
+        <<setw(10)<<"inserts/s"<<setw(9)<<"MB/s"<<setw(10)<<"sumfill s"
+        <<setw(9)<<"rd p50"<<setw(9)<<"rd p95"<<setw(9)<<"rd p99"
+        <<setw(10)<<"sum p50"<<setw(10)<<"sum p99"
+        <<setw(9)<<"db MB"<<endl;
+
+    cout<<fixed<<setprecision(1);
+    for (auto& profile : profiles) {
+        auto r = runProfile(profile, channels, seconds);
+
+        cout<<left
+            <<setw(7)<<r.profile.pageSize<<setw(8)<<r.profile.synchronous<<setw(6)<<r.profile.journalMode
+            <<setw(7)<<r.profile.mmapSize/(1024*1024)<<setw(8)<<cacheMB(r.profile)<<setw(8)<<r.profile.blockBytes/1024
+            <<right
+            <<setw(10)<<r.insertsPerSec<<setw(9)<<r.writeMBs<<setw(10)<<r.summaryFillSecs
+            <<setw(9)<<r.readP50<<setw(9)<<r.readP95<<setw(9)<<r.readP99
+            <<setw(10)<<r.summaryP50<<setw(10)<<r.summaryP99
+            <<setw(9)<<r.dbMB<<endl;
+    }
+    cout<<"(read latencies in microseconds)"<<endl;
+
+    return 0;
+}
@@ -8,6 +8,7 @@
 
 #include "Snapshots.h"
 
+#include <algorithm>
 #include <iostream>
 #include <utility>
 
@@ -33,6 +34,26 @@ int SnapshotHandler::newSnapshot(double time) {
     return snapshot.number;
 }
 
+int SnapshotHandler::insertSnapshot(double time, std::string name) {
+    Snapshot snapshot;
+    snapshot.timestamp = time;
+    snapshot.name = std::move(name);
+
+    auto it = std::find_if(mSnapshots.begin(), mSnapshots.end(), [time](const Snapshot& s) {return s.timestamp > time;});
+    const int number = it - mSnapshots.begin();
+    mSnapshots.insert(it, snapshot);
+
+    for (int i = number; i < mSnapshots.size(); ++i) {
+        mSnapshots[i].number = i;
+    }
+    //keep pointing at the same snapshot
+    if (number <= mCurrentSnapshot && mSnapshots.size() > 1) {
+        mCurrentSnapshot++;
+    }
+
+    return number;
+}
+
 int SnapshotHandler::newSnapshot(snapshotMidi key, double time) {
     Snapshot snapshot;
     if ((snapshot = getSnapshot(key)).timestamp == -1) {
@@ -92,7 +113,8 @@ void SnapshotHandler::assignName(std::string name, int key) {
 }
 
 void SnapshotHandler::save() {
-    auto stmt = mSaveConn->Prepare("INSERT INTO snapshots (snapshotNum, time, controller, change, name) "
+    //replace, inserted snapshots renumber the ones after them
+    auto stmt = mSaveConn->Prepare("INSERT OR REPLACE INTO snapshots (snapshotNum, time, controller, change, name) "
                                    "                    VALUES(?1, ?2, ?3, ?4, ?5)");
 
     for (auto s: mSnapshots) {
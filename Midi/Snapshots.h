@@ -44,6 +44,8 @@ public:
 
     int newSnapshot(snapshotMidi key, double time);
     int newSnapshot(double time);
+    //goes in time order, the snapshots after it move up a number
+    int insertSnapshot(double time, std::string name = "");
 
     Snapshot getSnapshot(snapshotMidi key);
     Snapshot getSnapshot(int key);
@@ -0,0 +1,289 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "LoudnessAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../../Audio/SampleKernels.h"
+#include "../../Threading/ThreadPool.h"
+
+size_t AudioGraph::LoudnessAnalyzer::sChunkSize = 65536;
+float AudioGraph::LoudnessAnalyzer::sSilenceDb = -80.0f;
+
+namespace {
+    //intersample peaks only go a few dB over the sample peak, chunks this far under the loudest so far cant raise it
+    constexpr float sTruePeakMargin = 2.0f;
+
+    struct Biquad {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        double z1 = 0, z2 = 0;
+
+        double process(double x) {
+            const double y = b0*x + z1;
+            z1 = b1*x - a1*y + z2;
+            z2 = b2*x - a2*y;
+            return y;
+        }
+        void reset() {z1 = z2 = 0;}
+    };
+
+    //the two stage k-weighting filter from BS.1770, worked out for the track rate since the spec only lists 48kHz
+    struct KWeighting {
+        Biquad shelf;
+        Biquad highPass;
+
+        explicit KWeighting(double rate) {
+            {
+                const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+                const double k = std::tan(M_PI*f0/rate);
+                const double vh = std::pow(10.0, gain/20.0);
+                const double vb = std::pow(vh, 0.4996667741545416);
+                const double a0 = 1.0 + k/q + k*k;
+
+                shelf.b0 = (vh + vb*k/q + k*k)/a0;
+                shelf.b1 = 2.0*(k*k - vh)/a0;
+                shelf.b2 = (vh - vb*k/q + k*k)/a0;
+                shelf.a1 = 2.0*(k*k - 1.0)/a0;
+                shelf.a2 = (1.0 - k/q + k*k)/a0;
+            }
+            {
+                const double f0 = 38.13547087602444, q = 0.5003270373238773;
+                const double k = std::tan(M_PI*f0/rate);
+                const double a0 = 1.0 + k/q + k*k;
+
+                highPass.b0 = 1.0;
+                highPass.b1 = -2.0;
+                highPass.b2 = 1.0;
+                highPass.a1 = 2.0*(k*k - 1.0)/a0;
+                highPass.a2 = (1.0 - k/q + k*k)/a0;
+            }
+        }
+
+        //sum of squares of the weighted samples
+        double sumSquares(const float* src, size_t len) {
+            double sum = 0;
+            for (size_t i = 0; i < len; ++i) {
+                const double y = highPass.process(shelf.process(src[i]));
+                sum += y*y;
+            }
+            return sum;
+        }
+        void reset() {shelf.reset(); highPass.reset();}
+    };
+
+    //4x polyphase interpolation for the true peak, a windowed sinc with 12 taps a phase. Phase 0 is just the
+    //samples themselves so only the 3 in between get worked out
+    class TruePeak {
+        static constexpr size_t sPhases = 4;
+        static constexpr size_t sTaps = 12;
+
+        float mCoefs[sPhases][sTaps];
+        //the last sTaps-1 samples of the previous chunk then the current one
+        std::vector<float> mBuffer;
+
+    public:
+        TruePeak() {
+            constexpr int length = sPhases*sTaps;
+            constexpr int centre = length/2;
+            for (int n = 0; n < length; ++n) {
+                const double x = double(n - centre)/sPhases;
+                const double sinc = x == 0 ? 1.0 : std::sin(M_PI*x)/(M_PI*x);
+                const double window = 0.5 + 0.5*std::cos(M_PI*(n - centre)/centre);
+                mCoefs[n%sPhases][n/sPhases] = float(sinc*window);
+            }
+            //each phase on its own passes dc at unity
+            for (auto& phase : mCoefs) {
+                float sum = 0;
+                for (float c : phase) {
+                    sum += c;
+                }
+                for (float& c : phase) {
+                    c /= sum;
+                }
+            }
+            mBuffer.reserve(sTaps - 1 + AudioGraph::LoudnessAnalyzer::sChunkSize);
+            reset();
+        }
+
+        //peak of the points in between the samples, without measure it only keeps the history going
+        float process(const float* src, size_t len, bool measure) {
+            mBuffer.insert(mBuffer.end(), src, src + len);
+
+            float peak = 0;
+            if (measure) {
+                for (size_t i = sTaps - 1; i < mBuffer.size(); ++i) {
+                    const float* x = &mBuffer[i];
+                    for (size_t p = 1; p < sPhases; ++p) {
+                        float sum = 0;
+                        for (size_t k = 0; k < sTaps; ++k) {
+                            sum += mCoefs[p][k]*x[-(ptrdiff_t)k];
+                        }
+                        peak = std::max(peak, std::fabs(sum));
+                    }
+                }
+            }
+
+            std::copy(mBuffer.end() - (sTaps - 1), mBuffer.end(), mBuffer.begin());
+            mBuffer.resize(sTaps - 1);
+            return peak;
+        }
+        void reset() {mBuffer.assign(sTaps - 1, 0.0f);}
+    };
+
+    //mean square every 100ms (all channels added), the 400ms gating blocks are made from 4 of these
+    struct Gate {
+        size_t hopLength;
+        double hopSum = 0;
+        size_t hopFill = 0;
+        std::vector<double> hops;
+
+        explicit Gate(size_t length) : hopLength(std::max<size_t>(length, 1)) {}
+
+        //what fits before the hop is done, add never gets given more than this
+        size_t room() const {return hopLength - hopFill;}
+        void add(double sumSq, size_t len) {
+            hopSum += sumSq;
+            hopFill += len;
+            if (hopFill == hopLength) {
+                hops.push_back(hopSum/hopLength);
+                hopSum = 0;
+                hopFill = 0;
+            }
+        }
+        void skip(size_t len) {
+            while (len > 0) {
+                const auto take = std::min(len, room());
+                add(0, take);
+                len -= take;
+            }
+        }
+
+        double integrated() const {
+            constexpr double floor = AudioGraph::LoudnessAnalyzer::sFloorLufs;
+            auto loudness = [](double meanSq) {return -0.691 + 10.0*std::log10(meanSq);};
+
+            //400ms blocks overlapping by 75%, a partial one at the end doesnt count
+            std::vector<double> blocks;
+            for (size_t j = 0; j + 4 <= hops.size(); ++j) {
+                blocks.push_back((hops[j] + hops[j+1] + hops[j+2] + hops[j+3])/4);
+            }
+
+            auto gatedMean = [&](double gate) {
+                double sum = 0;
+                size_t count = 0;
+                for (double block : blocks) {
+                    if (block > gate) {
+                        sum += block;
+                        count++;
+                    }
+                }
+                return count ? sum/count : 0.0;
+            };
+
+            const double absolute = std::pow(10.0, (floor + 0.691)/10.0);
+            const double ungated = gatedMean(absolute);
+            if (ungated <= 0) {
+                return floor;
+            }
+            //relative gate sits 10 LU under the loudness of what got past the absolute one
+            const double gated = gatedMean(std::max(absolute, ungated/10.0));
+            return gated > 0 ? loudness(gated) : floor;
+        }
+    };
+}
+
+std::vector<AudioGraph::LoudnessAnalyzer::Result> AudioGraph::LoudnessAnalyzer::analyze(std::atomic<size_t> *progress) {
+    std::vector<Result> results(mTracks.size());
+    ThreadPool::Get().parallelFor(mTracks.size(), [&](size_t t) {
+        results[t] = analyzeTrack(*mTracks[t], progress);
+    });
+    return results;
+}
+
+AudioGraph::LoudnessAnalyzer::Result AudioGraph::LoudnessAnalyzer::analyzeTrack(const Track &track, std::atomic<size_t> *progress) {
+    const auto numChannels = track.NChannels();
+    const double rate = track.GetRate();
+    const float silence = std::pow(10.0f, sSilenceDb/20.0f);
+
+    Result result {sFloorLufs, 0, 0, 0, track.getSampleCount(), 0};
+
+    std::vector<std::unique_ptr<SequenceReader>> readers;
+    std::vector<KWeighting> filters;
+    std::vector<TruePeak> truePeaks(numChannels);
+    std::vector<std::vector<float>> chunk(numChannels, std::vector<float>(sChunkSize));
+    for (size_t c = 0; c < numChannels; ++c) {
+        readers.push_back(track.makeReader(c));
+        filters.emplace_back(rate);
+    }
+
+    Gate gate(size_t(std::lround(rate/10)));
+
+    for (sampleCount pos = 0; pos < result.length;) {
+        const size_t len = std::min<size_t>(sChunkSize, (result.length - pos).as_size_t());
+
+        //summaries first, a chunk that cant get past the gate never gets read
+        float summaryPeak = 0;
+        for (size_t c = 0; c < numChannels; ++c) {
+            const auto summary = track.getSummary(c, pos, len, 1)[0];
+            summaryPeak = std::max({summaryPeak, summary.max, -summary.min});
+        }
+
+        if (summaryPeak < silence) {
+            result.samplePeak = std::max(result.samplePeak, summaryPeak);
+            result.skipped += len;
+
+            //long enough for the filters to have died away anyway, so starting them again from nothing is the same
+            for (size_t c = 0; c < numChannels; ++c) {
+                filters[c].reset();
+                truePeaks[c].reset();
+            }
+            gate.skip(len);
+        } else {
+            for (size_t c = 0; c < numChannels; ++c) {
+                readers[c]->Read((samplePtr) chunk[c].data(), floatSample, pos, len);
+
+                const auto levels = CalcMinMaxSumSq(chunk[c].data(), len);
+                const float peak = std::max(levels.max, -levels.min);
+                result.samplePeak = std::max(result.samplePeak, peak);
+
+                if (peak >= 1.0f) {
+                    result.clips += std::count_if(chunk[c].begin(), chunk[c].begin() + len, [](float s) {return std::fabs(s) >= 1.0f;});
+                }
+
+                const bool measure = peak*sTruePeakMargin >= result.truePeak;
+                result.truePeak = std::max({result.truePeak, peak, truePeaks[c].process(chunk[c].data(), len, measure)});
+            }
+
+            //hop by hop so every channel goes into the same hop
+            for (size_t offset = 0; offset < len;) {
+                const auto take = std::min(len - offset, gate.room());
+                double sumSq = 0;
+                for (size_t c = 0; c < numChannels; ++c) {
+                    sumSq += filters[c].sumSquares(chunk[c].data() + offset, take);
+                }
+                gate.add(sumSq, take);
+                offset += take;
+            }
+        }
+
+        pos += len;
+        if (progress) {
+            progress->fetch_add(len, std::memory_order_relaxed);
+        }
+    }
+
+    result.truePeak = std::max(result.truePeak, result.samplePeak);
+    result.integrated = gate.integrated();
+    return result;
+}
+
+double AudioGraph::LoudnessAnalyzer::toDb(float level) {
+    return level > 0 ? 20.0*std::log10(level) : -HUGE_VAL;
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+#include <atomic>
+#include <vector>
+
+#include "../Track.h"
+
+
+namespace AudioGraph {
+    //Integrated loudness (BS.1770 k-weighting and gating), true peak and clipping for whole tracks. Every track
+    //runs on its own task and streams through a chunk at a time, chunks the summaries say are too quiet to get
+    //past the loudness gate are never read off the disk
+    class LoudnessAnalyzer {
+    public:
+        struct Result {
+            //LUFS, sFloorLufs if nothing got past the gates
+            double integrated;
+            //linear, from 4x oversampling
+            float truePeak;
+            float samplePeak;
+            //samples at or over full scale, all channels together
+            uint64_t clips;
+            //per channel
+            sampleCount length;
+            sampleCount skipped;
+        };
+
+    private:
+        Tracks mTracks;
+
+    public:
+        explicit LoudnessAnalyzer(const Tracks& tracks) : mTracks(tracks) {}
+
+        //one result per track in the same order. progress counts samples (per channel) done over all tracks
+        std::vector<Result> analyze(std::atomic<size_t>* progress = nullptr);
+
+        static Result analyzeTrack(const Track& track, std::atomic<size_t>* progress = nullptr);
+
+        static double toDb(float level);
+
+        //STATIC MEMBERS
+        static size_t sChunkSize;
+        //k-weighting adds about 4dB at most, so a chunk peaking under this cant have a block over the -70 LUFS gate
+        static float sSilenceDb;
+        static constexpr double sFloorLufs = -70.0;
+    };
+}
+
+
+
+#endif //LOUDNESSANALYZER_H
@@ -0,0 +1,141 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "MixdownEngine.h"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "../../Audio/SampleKernels.h"
+#include "../../Threading/BoundedQueue.h"
+#include "../../Threading/ThreadPool.h"
+
+size_t AudioGraph::MixdownEngine::sDefaultBlockSize = 65536;
+
+AudioGraph::MixdownEngine::MixdownEngine(const Tracks &tracks, size_t blockSize)
+    : mBlockSize(blockSize) {
+    bool hasSolo = false;
+    for (auto& track : tracks) {
+        hasSolo |= track->isSolo();
+    }
+
+    for (auto& track : tracks) {
+        //same rule as playback
+        if (!track->isSolo() && (hasSolo || track->isMute())) {
+            continue;
+        }
+
+        Source source;
+        source.track = track;
+        for (size_t i = 0; i < track->NChannels(); ++i) {
+            source.readers.push_back(track->makeReader(i));
+        }
+        source.scratch.reInit(track->NChannels(), mBlockSize, 1);
+
+        const float gain = track->getGain();
+        const float pan = track->getPan();
+        if (isMono(*track)) {
+            //constant power so a mono track keeps its loudness as it moves across
+            const float angle = (pan + 1.0f)*float(M_PI)/4.0f;
+            source.gains[0][0] = gain*std::cos(angle);
+            source.gains[0][1] = gain*std::sin(angle);
+        } else {
+            //stereo tracks just get balance, each side turned down as its panned away from
+            source.gains[0][0] = gain*std::min(1.0f, 1.0f - pan);
+            source.gains[1][1] = gain*std::min(1.0f, 1.0f + pan);
+        }
+
+        mSources.push_back(std::move(source));
+    }
+}
+
+bool AudioGraph::MixdownEngine::render(sampleCount start, sampleCount end, const Sink &sink) {
+    //two buses so the sink can work on one while the next block gets mixed into the other
+    constexpr size_t numBuses = 2;
+    std::vector<std::vector<float>> busData(numBuses*2, std::vector<float>(mBlockSize));
+    std::vector<size_t> busSamples(numBuses);
+
+    BoundedQueue<size_t> freeBuses(numBuses);
+    BoundedQueue<size_t> toSink(numBuses);
+    for (size_t b = 0; b < numBuses; ++b) {
+        freeBuses.push(b);
+    }
+
+    std::atomic<bool> stopped {false};
+    std::thread sinkThread([&] {
+        while (auto bus = toSink.pop()) {
+            const float* channels[2] = {busData[*bus*2].data(), busData[*bus*2 + 1].data()};
+            if (!sink(channels, busSamples[*bus])) {
+                stopped = true;
+                freeBuses.close();
+                break;
+            }
+            freeBuses.push(*bus);
+        }
+    });
+
+    for (sampleCount pos = start; pos < end && !stopped;) {
+        auto bus = freeBuses.pop();
+        if (!bus) {
+            break;
+        }
+
+        const size_t samples = std::min(mBlockSize, (end - pos).as_size_t());
+        float* channels[2] = {busData[*bus*2].data(), busData[*bus*2 + 1].data()};
+
+        readSources(pos, samples);
+        mixSlices(channels, samples);
+
+        busSamples[*bus] = samples;
+        toSink.push(*bus);
+        pos += samples;
+    }
+
+    toSink.close();
+    sinkThread.join();
+
+    return !stopped;
+}
+
+void AudioGraph::MixdownEngine::readSources(sampleCount pos, size_t samples) {
+    //tracks read one per task, this is the part waiting on the disk
+    ThreadPool::Get().parallelFor(mSources.size(), [&](size_t s) {
+        auto& source = mSources[s];
+        for (size_t i = 0; i < source.readers.size(); ++i) {
+            source.readers[i]->Read((samplePtr) &source.scratch.getWritePosition(i), floatSample, pos, samples);
+            //the blob belongs to this threads read connection and the next block could be read on any thread,
+            //so it has to be closed here and not when another thread notices the connection changed
+            source.readers[i]->Close();
+        }
+    });
+}
+
+void AudioGraph::MixdownEngine::mixSlices(float *const *bus, size_t samples) {
+    //split by samples not by tracks so every sample is summed in the same order whatever thread gets it
+    const size_t numSlices = (samples + sSliceSize - 1)/sSliceSize;
+    ThreadPool::Get().parallelFor(numSlices, [&](size_t slice) {
+        const size_t offset = slice*sSliceSize;
+        const size_t len = std::min(sSliceSize, samples - offset);
+
+        for (size_t c = 0; c < 2; ++c) {
+            std::fill(bus[c] + offset, bus[c] + offset + len, 0.0f);
+        }
+
+        for (auto& source : mSources) {
+            for (size_t i = 0; i < source.readers.size(); ++i) {
+                auto src = reinterpret_cast<const float*>(source.scratch.getReadPosition(i)) + offset;
+                for (size_t c = 0; c < 2; ++c) {
+                    if (source.gains[i][c] != 0.0f) {
+                        MixAccumulate(src, source.gains[i][c], bus[c] + offset, len);
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef MIXDOWNENGINE_H
+#define MIXDOWNENGINE_H
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "buffers.h"
+#include "../Track.h"
+
+
+namespace AudioGraph {
+    //Offline stereo mix of a set of tracks using their gain, pan, mute and solo. Every block the tracks are read
+    //in parallel into their own buffers, then the bus gets split into slices and each slice adds the tracks up in
+    //track order, so the mix comes out the same bits however many threads did it
+    class MixdownEngine {
+        struct Source {
+            std::shared_ptr<Track> track;
+            std::vector<std::unique_ptr<SequenceReader>> readers;
+            buffers scratch;
+            //[track channel][bus channel]
+            float gains[2][2] = {};
+        };
+
+        std::vector<Source> mSources;
+        size_t mBlockSize;
+
+        //STATIC MEMBERS
+        static size_t sDefaultBlockSize;
+        //bus samples per reduction task
+        static constexpr size_t sSliceSize = 8192;
+
+    public:
+        //left and right, samples long. Called in order on one thread, return false to stop the render
+        using Sink = std::function<bool(const float* const* bus, size_t samples)>;
+
+        //takes the mix settings as they are now, silenced tracks are left out completely
+        explicit MixdownEngine(const Tracks& tracks, size_t blockSize = sDefaultBlockSize);
+
+        //false if the sink stopped it
+        bool render(sampleCount start, sampleCount end, const Sink& sink);
+
+        size_t numSources() const {return mSources.size();}
+
+        static void setDefaultBlockSize(size_t size) {sDefaultBlockSize = std::max<size_t>(size, sSliceSize);}
+
+    private:
+        void readSources(sampleCount pos, size_t samples);
+        void mixSlices(float* const* bus, size_t samples);
+    };
+}
+
+
+
+#endif //MIXDOWNENGINE_H
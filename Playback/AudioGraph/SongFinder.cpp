@@ -0,0 +1,181 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "SongFinder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../../Threading/ThreadPool.h"
+
+AudioGraph::SongFinder::SongFinder(const Tracks &tracks, const Settings &settings)
+    : mTracks(tracks), mSettings(settings) {
+    mThreshold = std::pow(10.0f, mSettings.silenceDb/20.0f);
+}
+
+std::vector<AudioGraph::SongFinder::Song> AudioGraph::SongFinder::find() {
+    std::vector<Song> songs;
+    mSamplesRead = 0;
+    if (mTracks.empty()) {
+        return songs;
+    }
+
+    mActive.assign(mTracks.size(), {});
+    ThreadPool::Get().parallelFor(mTracks.size(), [&](size_t t) {
+        mActive[t] = scanTrack(*mTracks[t]);
+    });
+
+    size_t numFrames = 0;
+    for (auto& active : mActive) {
+        numFrames = std::max(numFrames, active.size());
+    }
+
+    //a song starts on the first loud frame after enough quiet ones, across all the tracks
+    const double rate = mTracks[0]->GetRate();
+    const auto minQuiet = (size_t)std::ceil(mSettings.minSilenceSecs*rate/sFrameSize);
+
+    std::vector<size_t> onsetFrames;
+    std::vector<size_t> quietStarts;
+    size_t quiet = 0;
+    for (size_t f = 0; f < numFrames; ++f) {
+        bool active = false;
+        for (auto& track : mActive) {
+            active |= f < track.size() && track[f];
+        }
+
+        if (!active) {
+            quiet++;
+            continue;
+        }
+        if (quiet >= std::max<size_t>(minQuiet, 1)) {
+            onsetFrames.push_back(f);
+            quietStarts.push_back(f - quiet);
+        }
+        quiet = 0;
+    }
+
+    songs.resize(onsetFrames.size());
+    ThreadPool::Get().parallelFor(onsetFrames.size(), [&](size_t s) {
+        auto& song = songs[s];
+        song.silenceStart = sampleCount(quietStarts[s]*sFrameSize);
+        song.onset = findOnset(onsetFrames[s]);
+
+        const auto preRoll = sampleCount(mSettings.preRollSecs*rate);
+        song.time = std::max(song.silenceStart, song.onset - preRoll).as_double()/rate;
+    });
+
+    return songs;
+}
+
+std::vector<char> AudioGraph::SongFinder::scanTrack(const Track &track) const {
+    const auto length = track.getSampleCount();
+    const auto numFrames = ((length + sFrameSize - 1)/sFrameSize).as_size_t();
+    std::vector<char> active(numFrames, 0);
+
+    //whole frames in one go so every bin lines up with the 64k summaries, then whatever is left at the end
+    const auto wholeFrames = (length/sFrameSize).as_size_t();
+    for (size_t c = 0; c < track.NChannels(); ++c) {
+        auto summary = track.getSummary(c, 0, sampleCount(wholeFrames*sFrameSize), wholeFrames);
+        if (wholeFrames < numFrames) {
+            summary.push_back(track.getSummary(c, sampleCount(wholeFrames*sFrameSize), length - wholeFrames*sFrameSize, 1)[0]);
+        }
+
+        for (size_t f = 0; f < numFrames; ++f) {
+            active[f] |= std::max(summary[f].max, -summary[f].min) >= mThreshold;
+        }
+    }
+
+    return active;
+}
+
+bool AudioGraph::SongFinder::isActive(const Track &track, size_t channel, sampleCount start, sampleCount end) const {
+    const auto summary = track.getSummary(channel, start, end - start, 1)[0];
+    return std::max(summary.max, -summary.min) >= mThreshold;
+}
+
+sampleCount AudioGraph::SongFinder::findOnset(size_t frame) {
+    const sampleCount frameStart = sampleCount(frame*sFrameSize);
+    const sampleCount frameEnd = frameStart + sFrameSize;
+
+    //only tracks loud in this frame can have the onset in it. Channels are gone through one at a time, their
+    //blocks (and so the summaries) dont have to line up with each other
+    sampleCount onset = frameEnd;
+    for (size_t t = 0; t < mTracks.size(); ++t) {
+        if (frame >= mActive[t].size() || !mActive[t][frame]) {
+            continue;
+        }
+        const Track& track = *mTracks[t];
+        for (size_t c = 0; c < track.NChannels(); ++c) {
+            //nothing after the earliest one so far is worth looking at
+            onset = std::min(onset, findChannelOnset(track, c, frameStart, std::min(frameEnd, onset)));
+        }
+    }
+
+    //the summaries said something was there, if the samples disagree the start of the frame is close enough
+    return onset == frameEnd ? frameStart : onset;
+}
+
+sampleCount AudioGraph::SongFinder::findChannelOnset(const Track &track, size_t channel, sampleCount start, sampleCount end) {
+    end = std::min(end, track.getSampleCount());
+    if (start >= end) {
+        return end;
+    }
+    const sampleCount searchEnd = end;
+
+    //onto the summary grid, the little bit this adds on either side was quiet anyway or gets checked below
+    start = track.alignToSummary(channel, start);
+    end = track.alignToSummary(channel, end, true);
+
+    //first piece anything is loud in, then split that up again until its down to one summary frame
+    while (end - start > sFinestFrame) {
+        const sampleCount pieceLen = std::max<sampleCount>((end - start)/sSplit, sFinestFrame);
+
+        sampleCount pieceStart = start;
+        sampleCount pieceEnd = end;
+        for (sampleCount next = start + pieceLen; next < end; next += pieceLen) {
+            const auto aligned = track.alignToSummary(channel, next);
+            if (aligned <= pieceStart) {
+                continue;
+            }
+            if (isActive(track, channel, pieceStart, aligned)) {
+                pieceEnd = aligned;
+                break;
+            }
+            pieceStart = aligned;
+        }
+
+        //another channel can be what made the frame loud
+        if (pieceEnd == end && !isActive(track, channel, pieceStart, end)) {
+            return searchEnd;
+        }
+
+        //the summaries are as fine as they go (a frame cut short by a block end), read what is left
+        if (pieceStart == start && pieceEnd == end) {
+            break;
+        }
+        start = pieceStart;
+        end = pieceEnd;
+    }
+
+    //sample accurate from here
+    end = std::min(end, searchEnd);
+    if (start >= end) {
+        return searchEnd;
+    }
+    const size_t len = (end - start).as_size_t();
+    std::vector<float> samples(len);
+    track.makeReader(channel)->Read((samplePtr) samples.data(), floatSample, start, len);
+    mSamplesRead.fetch_add(len, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < len; ++i) {
+        if (std::fabs(samples[i]) >= mThreshold) {
+            return start + i;
+        }
+    }
+    return searchEnd;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef SONGFINDER_H
+#define SONGFINDER_H
+#include <atomic>
+#include <vector>
+
+#include "../Track.h"
+
+
+namespace AudioGraph {
+    //Finds where songs start in a show, a long stretch where every selected track is quiet and then something
+    //comes in. The whole show is scanned on the 64k summaries (every track in parallel), each onset then gets
+    //narrowed down through finer summaries and only the last 256 samples around it are ever read. The pieces are
+    //lined up with each blocks summaries so none of the probes have to read samples either
+    class SongFinder {
+    public:
+        struct Settings {
+            //peaks under this count as silence, and the first sample over it is the onset
+            float silenceDb;
+            double minSilenceSecs;
+            //the snapshot goes this far before the onset, but never before the silence started
+            double preRollSecs;
+        };
+
+        struct Song {
+            sampleCount silenceStart;
+            sampleCount onset;
+            //where the snapshot should go, in seconds
+            double time;
+        };
+
+    private:
+        Tracks mTracks;
+        Settings mSettings;
+        float mThreshold;
+
+        //which 64k frames of each track have anything over the threshold
+        std::vector<std::vector<char>> mActive;
+
+        std::atomic<size_t> mSamplesRead {0};
+
+    public:
+        SongFinder(const Tracks& tracks, const Settings& settings);
+
+        std::vector<Song> find();
+
+        //raw samples the last find read to place the onsets, all tracks and channels together
+        size_t samplesRead() const {return mSamplesRead.load();}
+
+        //STATIC MEMBERS
+        static constexpr size_t sFrameSize = 65536;
+        //each refinement step splits the range this many ways, 64k -> 4096 -> 256 -> samples
+        static constexpr size_t sSplit = 16;
+        static constexpr size_t sFinestFrame = 256;
+
+    private:
+        std::vector<char> scanTrack(const Track& track) const;
+        sampleCount findOnset(size_t frame);
+        //earliest sample over the threshold in [start, end) of one channel, end if there isnt one
+        sampleCount findChannelOnset(const Track& track, size_t channel, sampleCount start, sampleCount end);
+        bool isActive(const Track& track, size_t channel, sampleCount start, sampleCount end) const;
+    };
+}
+
+
+
+#endif //SONGFINDER_H
@@ -12,10 +12,17 @@
 #include <vector>
 
 #include "../../Audio/SampleCount.h"
+#include "../../Audio/AudioData/Sequence.h"
 #include "../../Audio/SampleFormat.h"
 #include "../AudioGraph/Channel.h"
 
 
+//blocks doGet has read from a prefetched sample view vs from storage
+struct ReadCounts {
+    size_t cached = 0;
+    size_t storage = 0;
+};
+
 struct PlaybackSequence : AudioGraph::Channel {
     ~PlaybackSequence() override;
 
@@ -31,6 +38,13 @@ struct PlaybackSequence : AudioGraph::Channel {
     virtual bool isSolo() const = 0;
     virtual bool isMute() const = 0;
 
+    //blocks that will be read next starting at pos, used for prefetching. Sequences without blocks just leave it empty
+    virtual void getUpcomingBlocks(size_t channel, sampleCount pos, bool backwards, size_t count, std::vector<SeqBlock>& blocks) const {}
+    //playback is done for now, let go of anything kept open between reads
+    virtual void finishReading() const {}
+    //only counts playback reads (doGet), safe to call from any thread
+    virtual ReadCounts getReadCounts() const {return {};}
+
     double LongSamplesToTime(sampleCount samples) const;
     sampleCount TimeToLongSamples(double time) const;
 };
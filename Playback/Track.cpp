@@ -13,6 +13,7 @@
 
 #include "../Visual/PlaybackHandler.h"
 
+bool Track::sLazyLoad = true;
 
 bool Track::append(size_t channel, constSamplePtr buffer, SampleFormat format, size_t len, unsigned int stride, SampleFormat effectiveFormat) {
     wxASSERT(channel < NChannels());
@@ -44,9 +45,23 @@ bool Track::doGet(size_t channel, samplePtr buffer, SampleFormat format, sampleC
     if (backwards) {
         start -= len;
     }
-    auto samplesToCopy = std::min((sampleCount)len, mSequences[channel]->GetSampleCount());
 
-    bool result = mSequences[channel]->getSamples(buffer, format, start, samplesToCopy.as_size_t());
+    std::lock_guard<std::mutex> lock(mReaderMutex);
+
+    auto &reader = mReaders[channel];
+    if (!reader) {
+        reader = std::make_unique<SequenceReader>(*mSequences[channel]);
+    }
+
+    const auto cachedBefore = reader->GetCachedReads();
+    const auto storageBefore = reader->GetStorageReads();
+
+    bool result = reader->Read(buffer, format, start, len);
+
+    mCachedReads.fetch_add(reader->GetCachedReads() - cachedBefore, std::memory_order_relaxed);
+    mStorageReads.fetch_add(reader->GetStorageReads() - storageBefore, std::memory_order_relaxed);
+    //an open blob is an open read transaction, held between passes it stops checkpoints getting past it
+    reader->ReleaseStorage();
 
     if (result && backwards) {
         ReverseSamples(buffer, format, 0, len);
@@ -55,7 +70,55 @@ bool Track::doGet(size_t channel, samplePtr buffer, SampleFormat format, sampleC
     return result;
 }
 
+void Track::getUpcomingBlocks(size_t channel, sampleCount pos, bool backwards, size_t count, std::vector<SeqBlock> &blocks) const {
+    wxASSERT(channel < NChannels());
+    mSequences[channel]->getBlocksFrom(pos, backwards, count, blocks);
+}
+
+void Track::finishReading() const {
+    std::lock_guard<std::mutex> lock(mReaderMutex);
+
+    for (auto &reader : mReaders) {
+        if (reader) {
+            reader->Close();
+        }
+    }
+}
+
+ReadCounts Track::getReadCounts() const {
+    return {mCachedReads.load(std::memory_order_relaxed), mStorageReads.load(std::memory_order_relaxed)};
+}
+
+std::unique_ptr<SequenceReader> Track::makeReader(size_t channel) const {
+    wxASSERT(channel < NChannels());
+    return std::make_unique<SequenceReader>(*mSequences[channel]);
+}
+
+size_t Track::getSilentBytes() const {
+    size_t bytes = 0;
+    for (auto &seq : mSequences) {
+        bytes += seq->GetSilentBytes();
+    }
+    return bytes;
+}
+
+double Track::getSilentFraction() const {
+    double silent = 0, total = 0;
+    for (auto &seq : mSequences) {
+        silent += seq->GetSilentSampleCount();
+        total += seq->GetSampleCount().as_double();
+    }
+    return total > 0 ? silent/total : 0.0;
+}
+
 void Track::updateSequences() {
+    {
+        //readers point into the old sequences
+        std::lock_guard<std::mutex> lock(mReaderMutex);
+        mReaders.clear();
+        mReaders.resize(NChannels());
+    }
+
     mSequences.clear();
     mSequences.resize(NChannels());
     for (int i = 0; i < NChannels(); ++i) {
@@ -67,26 +130,36 @@ void Track::updateSequences() {
 
 void Track::save() {
     auto stmt = mSaveConn->Prepare("INSERT INTO tracks (trackType, firstChannelIn, firstChannelOut,"
-                                   "                        sampleRate, blocks)"
-                                   "                VALUES(?1, ?2, ?3, ?4, ?5);");
+                                   "                        sampleRate, blocks, blockOffsets)"
+                                   "                VALUES(?1, ?2, ?3, ?4, ?5, ?6);");
 
 
     std::vector<int> blocks;
+    //start sample of every block + the total length at the end, laid out the same way as the ids
+    std::vector<int64_t> offsets;
     //Using number of blocks for the first one, as both sequences have the same number of blocks
     for (int i = 0; i < mSequences[0]->getBlockCount(); ++i) {
         blocks.push_back(mSequences[0]->getBlockIDAtIndex(i));
+        offsets.push_back(mSequences[0]->getBlockStartAtIndex(i).as_long_long());
         if (NChannels()>1) {
             blocks.push_back(mSequences[1]->getBlockIDAtIndex(i));
+            offsets.push_back(mSequences[1]->getBlockStartAtIndex(i).as_long_long());
         }
     }
+    offsets.push_back(mSequences[0]->GetSampleCount().as_long_long());
+    if (NChannels()>1) {
+        offsets.push_back(mSequences[1]->GetSampleCount().as_long_long());
+    }
 
     size_t blocksBytes = sizeof(int)*blocks.size();
+    size_t offsetsBytes = sizeof(int64_t)*offsets.size();
 
     if (sqlite3_bind_int(stmt, 1, mNumChannels) ||
         sqlite3_bind_int(stmt, 2, mFirstChannelNumIn) ||
         sqlite3_bind_int(stmt, 3, mFirstChannelNumOut) ||
         sqlite3_bind_double(stmt, 4, mRate) ||
-        sqlite3_bind_blob(stmt, 5, blocks.data(), blocksBytes, SQLITE_STATIC)) {
+        sqlite3_bind_blob(stmt, 5, blocks.data(), blocksBytes, SQLITE_STATIC) ||
+        sqlite3_bind_blob(stmt, 6, offsets.data(), offsetsBytes, SQLITE_STATIC)) {
         wxASSERT(false);
     }
 
@@ -123,8 +196,8 @@ void Track::newShow() {
 
 
 void Track::load(int id) {
-    std::cout<<"loading Track"<<id<<std::endl;
-    auto stmt = mSaveConn->Prepare("SELECT trackType, firstChannelIn, firstChannelOut, sampleRate, blocks "
+    //load can run on a worker thread so use a read connection rather than the shared one
+    auto stmt = mSaveConn->PrepareRead("SELECT trackType, firstChannelIn, firstChannelOut, sampleRate, blocks, blockOffsets "
                                    "FROM tracks WHERE trackNum = ?1;");
 
     if (sqlite3_bind_int(stmt, 1, id)) {
@@ -144,14 +217,33 @@ void Track::load(int id) {
     blockIDs.resize(bytes/sizeof(int));
     memcpy(blockIDs.data(), sqlite3_column_blob(stmt, 4), bytes);
 
+    std::vector<int64_t> offsets;
+    auto offsetBytes = sqlite3_column_bytes(stmt, 5);
+    offsets.resize(offsetBytes/sizeof(int64_t));
+    if (offsetBytes) {
+        memcpy(offsets.data(), sqlite3_column_blob(stmt, 5), offsetBytes);
+    }
+
     updateSequences();
 
+    size_t numBlocks = blockIDs.size()/NChannels();
+
+    //older saves (or a mismatch) dont have usable offsets so fall back to reading every block
+    bool lazy = sLazyLoad && offsets.size() == (numBlocks+1)*NChannels();
+
     for (int i = 0; i < NChannels(); ++i) {
-        for (int x = 0; x < blockIDs.size()/NChannels(); ++x) {
-            mSequences[i]->loadBlockFromID(blockIDs[x*NChannels()+i]);
+        for (int x = 0; x < numBlocks; ++x) {
+            if (lazy) {
+                auto start = offsets[x*NChannels()+i];
+                auto end = offsets[(x+1)*NChannels()+i];
+                mSequences[i]->loadBlockFromID(blockIDs[x*NChannels()+i], end-start);
+            } else {
+                mSequences[i]->loadBlockFromID(blockIDs[x*NChannels()+i]);
+            }
         }
     }
 
     sqlite3_finalize(stmt);
-    std::cout<<"finished loading track num: "<<id<<std::endl;
+    //tracks load in parallel so print the line in one go
+    std::cout<<("finished loading track num: " + std::to_string(id) + "\n")<<std::flush;
 }
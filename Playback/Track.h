@@ -8,7 +8,9 @@
 
 #ifndef TRACK_H
 #define TRACK_H
+#include <algorithm>
 #include <atomic>
+#include <mutex>
 
 #include "../Audio/AudioData/Sequence.h"
 #include "../Saving/SaveFileDB.h"
@@ -33,10 +35,23 @@ class Track
     std::atomic<bool> mSolo;
     std::atomic<bool> mMute;
 
+    //only used for the mixdown, linear gain and -1 (left) to 1 (right)
+    std::atomic<float> mGain {1.0f};
+    std::atomic<float> mPan {0.0f};
+
     std::vector<std::unique_ptr<Sequence>> mSequences;
 
+    //one cursor per channel for playback, made the first time the channel is read
+    mutable std::vector<std::unique_ptr<SequenceReader>> mReaders;
+    mutable std::mutex mReaderMutex;
+    mutable std::atomic<size_t> mCachedReads {0};
+    mutable std::atomic<size_t> mStorageReads {0};
+
     int mTrackNum;
 
+    //when set, load only reads the block list and offsets, the blocks fetch their own metadata when first used
+    static bool sLazyLoad;
+
 public:
     Track(double rate, SampleFormat format, int trackNum)
         :mRate(rate), mFormat(format), mSolo(false), mMute(false), mTrackNum(trackNum) {
@@ -51,6 +66,13 @@ public:
     void setRate(double rate) {mRate = rate;} ;
 
     double getLengthS(){return mSequences[0]->GetSampleCount().as_double()/mRate;}
+    sampleCount getSampleCount() const {return mSequences[0]->GetSampleCount();}
+    //min/max/rms of one channel in bins, from the summaries, see Sequence::GetSummary
+    std::vector<MaxMinRMS> getSummary(size_t channel, sampleCount start, sampleCount len, size_t bins) const {return mSequences[channel]->GetSummary(start, len, bins);}
+    sampleCount alignToSummary(size_t channel, sampleCount pos, bool up = false) const {return mSequences[channel]->AlignToSummary(pos, up);}
+    //disk space saved by storing silence as silent blocks, all channels together
+    size_t getSilentBytes() const;
+    double getSilentFraction() const;
 
     //saving
     void save() override;
@@ -74,12 +96,28 @@ public:
 
     //Playback Sequence specific Overrides
     bool doGet(size_t channel, samplePtr buffer, SampleFormat format, sampleCount start, size_t len, bool backwards) const override;
+    void getUpcomingBlocks(size_t channel, sampleCount pos, bool backwards, size_t count, std::vector<SeqBlock>& blocks) const override;
+    void finishReading() const override;
+    ReadCounts getReadCounts() const override;
+
+    //separate cursor for reading the channel start to finish without disturbing playback (exporting)
+    std::unique_ptr<SequenceReader> makeReader(size_t channel) const;
 
     bool isSolo() const override {return mSolo.load(std::memory_order_relaxed);}
     bool isMute() const override {return mMute.load(std::memory_order_relaxed);}
+    void toggleSolo() {mSolo.store(!isSolo(), std::memory_order_relaxed);}
+    void toggleMute() {mMute.store(!isMute(), std::memory_order_relaxed);}
+
+    float getGain() const {return mGain.load(std::memory_order_relaxed);}
+    float getPan() const {return mPan.load(std::memory_order_relaxed);}
+    void setGain(float gain) {mGain.store(std::max(gain, 0.0f), std::memory_order_relaxed);}
+    void setPan(float pan) {mPan.store(std::clamp(pan, -1.0f, 1.0f), std::memory_order_relaxed);}
 
     int getTrackNum() const {return mTrackNum;}
 
+    static void setLazyLoad(bool lazy) {sLazyLoad = lazy;}
+    static bool isLazyLoad() {return sLazyLoad;}
+
 private:
     size_t GetGreatestAppendBufferLen() const;
     void updateSequences();
@@ -8,31 +8,51 @@
 
 #include "DBConnection.h"
 
+#include <cstring>
 #include <iostream>
 
 #define PROJECT_PAGE_SIZE 65536
 
-#define str(a) #a
-#define xstr(a) str(a)
-
 static const char* PageSizeConfig =
-   "PRAGMA <schema>.page_size = " xstr(PROJECT_PAGE_SIZE) ";"
+   "PRAGMA <schema>.page_size = <pageSize>;"
    "VACUUM;";
 
-// Configuration to provide "safe" connections
-static const char* SafeConfig =
+// Configuration shared by every profile, the rest comes from StorageProfile
+static const char* BaseConfig =
    "PRAGMA <schema>.busy_timeout = 5000;"
-   "PRAGMA <schema>.locking_mode = SHARED;"
-   "PRAGMA <schema>.synchronous = NORMAL;"
-   "PRAGMA <schema>.journal_mode = WAL;"
-   "PRAGMA <schema>.wal_autocheckpoint = 0;";
+   "PRAGMA <schema>.locking_mode = SHARED;";
+
+// Configuration for the per thread read only connections, the mmap and cache come from StorageProfile
+static const char *ReaderConfig =
+   "PRAGMA <schema>.busy_timeout = 5000;";
+
+// "safe" connections
+StorageProfile StorageProfile::Safe() {
+   StorageProfile profile;
+   profile.pageSize = PROJECT_PAGE_SIZE;
+   profile.synchronous = "NORMAL";
+   profile.journalMode = "WAL";
+   return profile;
+}
 
-// Configuration to provide "Fast" connections
-static const char *FastConfig =
-   "PRAGMA <schema>.busy_timeout = 5000;"
-   "PRAGMA <schema>.locking_mode = SHARED;"
-   "PRAGMA <schema>.synchronous = OFF;"
-   "PRAGMA <schema>.journal_mode = OFF;";
+// "Fast" connections
+StorageProfile StorageProfile::Fast() {
+   StorageProfile profile;
+   profile.pageSize = PROJECT_PAGE_SIZE;
+   profile.synchronous = "OFF";
+   profile.journalMode = "OFF";
+   return profile;
+}
+
+StorageProfile DBConnection::sSafeProfile = StorageProfile::Safe();
+StorageProfile DBConnection::sFastProfile = StorageProfile::Fast();
+
+float DBConnection::sHighRecordPressure = 0.5f;
+float DBConnection::sLowRecordPressure = 0.25f;
+double DBConnection::sThrottleWriteRate = 64.0*1024*1024;
+size_t DBConnection::sMaxWalBytes = 512*1024*1024;
+std::chrono::milliseconds DBConnection::sMaxCheckpointDefer {30000};
+size_t DBConnection::sBatchBytes = 64*1024*1024;
 
 DBConnection::DBConnection() {
    mDB = nullptr;
@@ -56,6 +76,13 @@ int DBConnection::open(const FilePath fileName, bool newFile) {
    mCheckpointPending = false;
    mCheckpointStop = false;
 
+   mWalPages = 0;
+   mRecordPressure = 0.0f;
+   {
+      std::lock_guard<std::mutex> guard(mMetricsMutex);
+      mMetrics = CheckpointMetrics();
+   }
+
    err = openStepByStep(fileName, newFile);
 
    //if error occurs clear databases
@@ -89,6 +116,7 @@ int DBConnection::openStepByStep(const FilePath fileName, bool newFile) {
    if (newFile) {
       err = setPageSize();
    }
+   mPageSize = sSafeProfile.pageSize;
 
    if (err != SQLITE_OK) {
       //ERR SETTING PAGE SIZE
@@ -110,7 +138,7 @@ int DBConnection::openStepByStep(const FilePath fileName, bool newFile) {
       wxASSERT(false);
    }
 
-   err = ModeConfig(mCheckpointDB, "main", SafeConfig);
+   err = ModeConfig(mCheckpointDB, "main", buildConfig(sSafeProfile).c_str());
 
    if (err != SQLITE_OK) {
       //FAILED TO SET CHECKPOINT CONFIG
@@ -139,12 +167,15 @@ sqlite3_stmt* DBConnection::Prepare(statementID id, const char *sql) {
    if (iter != mStatements.end()) {
       return iter->second;
    }
+   //reads go through this threads own connection
+   sqlite3* db = isReadStatement(id) ? ReadDB() : mDB;
+
    sqlite3_stmt* stmt;
-   err = sqlite3_prepare_v3(mDB, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0);
+   err = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0);
 
    if (err != SQLITE_OK) {
       //FAILED TO PREPARE STATMENT
-      std::cout<< "Err Code: "<< sqlite3_errstr(sqlite3_extended_errcode(mDB)) << std::endl;
+      std::cout<< "Err Code: "<< sqlite3_errstr(sqlite3_extended_errcode(db)) << std::endl;
       wxASSERT(false);
    }
 
@@ -202,6 +233,8 @@ bool DBConnection::close() {
       mStatements.clear();
    }
 
+   closeReaders();
+
    //close the DB connections
    sqlite3_close(mDB);
    sqlite3_close(mCheckpointDB);
@@ -224,6 +257,59 @@ sqlite3 *DBConnection::DB() {
    return mDB;
 }
 
+sqlite3 *DBConnection::ReadDB() {
+   std::lock_guard<std::mutex> guard(mReaderMutex);
+
+   auto iter = mReaders.find(std::this_thread::get_id());
+   if (iter != mReaders.end()) {
+      return iter->second;
+   }
+
+   sqlite3* db = nullptr;
+   int err = sqlite3_open_v2(mPath.ToUTF8(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+
+   if (err == SQLITE_OK) {
+      err = ModeConfig(db, "main", buildReaderConfig(mReaderProfile).c_str());
+   }
+
+   if (err != SQLITE_OK) {
+      //couldnt get a reader so just share the main connection
+      std::cerr<<"Failed to open read connection, err code: "<<sqlite3_errstr(err)<<std::endl;
+      sqlite3_close(db);
+      return mDB;
+   }
+
+   mReaders.insert({std::this_thread::get_id(), db});
+
+   return db;
+}
+
+void DBConnection::closeReaders() {
+   std::lock_guard<std::mutex> guard(mReaderMutex);
+
+   for (auto& reader: mReaders) {
+      //_v2 so a sequence reader still holding a blob doesnt keep the close from happening,
+      //the connection goes away once that blob is closed
+      sqlite3_close_v2(reader.second);
+   }
+
+   mReaders.clear();
+}
+
+bool DBConnection::isReadStatement(statementID id) {
+   switch (id) {
+      case GetSamples:
+      case GetSummary256:
+      case GetSummary64k:
+      case LoadSampleBlock:
+      case GetSampleBlockSize:
+      case GetAllSampleBlocksSize:
+         return true;
+      default:
+         return false;
+   }
+}
+
 int DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *config) {
    int err;
 
@@ -241,18 +327,109 @@ int DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *config
    return err;
 }
 
-int DBConnection::FastMode(const char *schema) {
-   return ModeConfig(mDB, schema, FastConfig);
+std::string DBConnection::buildConfig(const StorageProfile &profile) {
+   std::string config = BaseConfig;
+   config += "PRAGMA <schema>.synchronous = " + profile.synchronous + ";";
+   config += "PRAGMA <schema>.journal_mode = " + profile.journalMode + ";";
+   config += "PRAGMA <schema>.mmap_size = " + std::to_string(profile.mmapSize) + ";";
+   config += "PRAGMA <schema>.cache_size = " + std::to_string(profile.cacheSize) + ";";
+
+   //the checkpoint thread handles these
+   if (profile.journalMode == "WAL") {
+      config += "PRAGMA <schema>.wal_autocheckpoint = 0;";
+   }
+
+   return config;
+}
+
+std::string DBConnection::buildReaderConfig(const StorageProfile &profile) {
+   std::string config = ReaderConfig;
+   config += "PRAGMA <schema>.mmap_size = " + std::to_string(profile.mmapSize) + ";";
+   config += "PRAGMA <schema>.cache_size = " + std::to_string(profile.cacheSize) + ";";
+   return config;
+}
+
+int DBConnection::applyProfile(const char *schema, const StorageProfile& profile) {
+   int err = ModeConfig(mDB, schema, buildConfig(profile).c_str());
+
+   if (err == SQLITE_OK && strcmp(schema, "main") == 0) {
+      //readers already open keep what they had, theyre only touched from their own thread
+      std::lock_guard<std::mutex> guard(mReaderMutex);
+      mReaderProfile = profile;
+   }
+
+   return err;
+}
+
+int DBConnection::FastMode(const char *schema, const StorageProfile& profile) {
+   return applyProfile(schema, profile);
 }
 
-int DBConnection::SafeMode(const char *schema) {
-   return ModeConfig(mDB, schema, SafeConfig);
+int DBConnection::SafeMode(const char *schema, const StorageProfile& profile) {
+   return applyProfile(schema, profile);
 }
 
-int DBConnection::setPageSize(const char *schema) {
+int DBConnection::setPageSize(const char *schema, int pageSize) {
    //IN FUTURE SHOULD PERFORM CHECK TO ENSURE EMPTY
 
-   return ModeConfig(mDB, schema, PageSizeConfig);
+   wxString config = PageSizeConfig;
+   config.Replace(wxT("<pageSize>"), std::to_string(pageSize).c_str());
+
+   return ModeConfig(mDB, schema, config.c_str());
+}
+
+
+//BATCHED WRITES
+
+void DBConnection::beginBatch() {
+   std::unique_lock<std::shared_mutex> lock(mBatchMutex);
+   if (mBatching) {
+      return;
+   }
+
+   if (sqlite3_exec(mDB, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      //FAILED TO START TRANSACTION
+      wxASSERT(false);
+      return;
+   }
+
+   mBatchBytes = 0;
+   mBatching = true;
+}
+
+void DBConnection::checkBatch() {
+   if (!mBatching || mBatchBytes.load(std::memory_order_relaxed) < sBatchBytes) {
+      return;
+   }
+
+   std::unique_lock<std::shared_mutex> lock(mBatchMutex);
+   //someone else may have just committed it
+   if (!mBatching || mBatchBytes < sBatchBytes) {
+      return;
+   }
+
+   if (sqlite3_exec(mDB, "COMMIT; BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      //FAILED TO COMMIT BATCH
+      wxASSERT(false);
+      noteWriteFailed();
+   }
+   mBatchBytes = 0;
+}
+
+bool DBConnection::endBatch() {
+   std::unique_lock<std::shared_mutex> lock(mBatchMutex);
+   if (!mBatching) {
+      return true;
+   }
+   mBatching = false;
+
+   if (sqlite3_exec(mDB, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      //FAILED TO COMMIT BATCH
+      wxASSERT(false);
+      noteWriteFailed();
+      return false;
+   }
+   return true;
 }
 
 
@@ -261,6 +438,8 @@ int DBConnection::setPageSize(const char *schema) {
 int DBConnection::checkpointHook(void *data, sqlite3 *db, const char *schema, int pages) {
    DBConnection* that = static_cast<DBConnection*>(data);
 
+   that->mWalPages.store(pages, std::memory_order_relaxed);
+
    std::lock_guard<std::mutex> guard(that->mCheckpointMutex);
    that->mCheckpointPending = true;
    that->mCheckpointCV.notify_one();
@@ -268,10 +447,52 @@ int DBConnection::checkpointHook(void *data, sqlite3 *db, const char *schema, in
    return SQLITE_OK;
 }
 
+CheckpointMetrics DBConnection::getCheckpointMetrics() {
+   std::lock_guard<std::mutex> guard(mMetricsMutex);
+   mMetrics.walBytes = mWalPages.load(std::memory_order_relaxed)*mPageSize;
+   return mMetrics;
+}
+
+double DBConnection::updateWriteRate() {
+   using namespace std::chrono;
+
+   auto now = steady_clock::now();
+   auto elapsed = duration<double>(now - mRateTime).count();
+
+   //short windows are too noisy to be useful
+   if (elapsed >= 0.25) {
+      auto bytes = mBytesWritten.load(std::memory_order_relaxed);
+      mWriteRate = (bytes - mRateBytes)/elapsed;
+      mRateBytes = bytes;
+      mRateTime = now;
+   }
+
+   return mWriteRate;
+}
+
+bool DBConnection::shouldDeferCheckpoint(bool deferring, std::chrono::steady_clock::duration deferredFor) {
+   //the wal is getting too big or weve waited long enough, checkpoint anyway
+   if (mWalPages.load(std::memory_order_relaxed)*mPageSize >= sMaxWalBytes ||
+       deferredFor >= sMaxCheckpointDefer) {
+      return false;
+   }
+
+   //once deferring, wait for the capture buffers to drain down to the low mark so we dont flip flop
+   auto pressure = mRecordPressure.load(std::memory_order_relaxed);
+   if (pressure >= (deferring ? sLowRecordPressure : sHighRecordPressure)) {
+      return true;
+   }
+
+   return updateWriteRate() >= sThrottleWriteRate;
+}
+
 void DBConnection::checkpointThread(sqlite3 *db, FilePath fileName) {
    int err = SQLITE_OK;
    bool giveup = false;
 
+   mRateBytes = mBytesWritten.load(std::memory_order_relaxed);
+   mRateTime = std::chrono::steady_clock::now();
+
    while (true) {
 
       {
@@ -292,10 +513,40 @@ void DBConnection::checkpointThread(sqlite3 *db, FilePath fileName) {
       {
          using namespace std::chrono;
 
+         //hold off while recording is struggling to keep up, recheck every so often
+         auto deferStart = steady_clock::now();
+         bool deferred = false;
+         while (!mCheckpointStop && shouldDeferCheckpoint(deferred, steady_clock::now() - deferStart)) {
+            deferred = true;
+
+            std::unique_lock<std::mutex> lock(mCheckpointMutex);
+            mCheckpointCV.wait_for(lock, 50ms, [&] {return mCheckpointStop.load();});
+         }
+
+         auto checkpointStart = steady_clock::now();
+         int logPages = 0;
+         int checkpointedPages = 0;
          do {
-            err = giveup ? SQLITE_OK : sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+            err = giveup ? SQLITE_OK : sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logPages, &checkpointedPages);
          } while (err == SQLITE_BUSY && (std::this_thread::sleep_for(1ms),true));
+         auto checkpointEnd = steady_clock::now();
 
+         //sqlite reuses the checkpointed part of the wal so only whats left still counts
+         if (err == SQLITE_OK && logPages >= checkpointedPages) {
+            mWalPages.store(logPages - checkpointedPages, std::memory_order_relaxed);
+         }
+
+         {
+            std::lock_guard<std::mutex> guard(mMetricsMutex);
+            auto checkpointMs = duration<double, std::milli>(checkpointEnd - checkpointStart).count();
+
+            mMetrics.checkpoints++;
+            mMetrics.deferred += deferred;
+            mMetrics.lastCheckpointMs = checkpointMs;
+            mMetrics.maxCheckpointMs = std::max(mMetrics.maxCheckpointMs, checkpointMs);
+            mMetrics.totalStallMs += duration<double, std::milli>(checkpointStart - deferStart).count();
+            mMetrics.writeRate = mWriteRate;
+         }
       }
 
       mCheckpointActive = false;
@@ -311,11 +562,3 @@ void DBConnection::checkpointThread(sqlite3 *db, FilePath fileName) {
       }
    }
 }
-
-
-
-
-
-
-
-
@@ -8,15 +8,48 @@
 
 #ifndef DBCONNECTION_H
 #define DBCONNECTION_H
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <map>
+#include <shared_mutex>
 #include <sqlite3.h>
+#include <string>
 #include <thread>
 #include <utility>
 #include <wx/string.h>
 
 using FilePath = wxString;
 
+//The knobs we tune storage with, see Benchmarks/StorageBenchmark.cpp for how the defaults were picked
+struct StorageProfile {
+    int pageSize = 65536;
+    std::string synchronous = "NORMAL";
+    std::string journalMode = "WAL";
+    size_t mmapSize = 0;
+    //page cache per connection, negative is KiB like sqlites own cache_size
+    int cacheSize = -2000;
+    //size of the sample blocks, applied through Sequence::setHardDiskBlockSize
+    size_t blockBytes = 1048576;
+
+    static StorageProfile Safe();
+    static StorageProfile Fast();
+};
+
+//What the checkpoint scheduler has been doing, read from the UI
+struct CheckpointMetrics {
+    size_t walBytes = 0;
+    size_t checkpoints = 0;
+    //number of checkpoints that had to wait for the record path to calm down
+    size_t deferred = 0;
+    double lastCheckpointMs = 0;
+    double maxCheckpointMs = 0;
+    //time checkpoints spent waiting on the record path before they could run
+    double totalStallMs = 0;
+    //bytes per second going into the db
+    double writeRate = 0;
+};
+
 class DBConnection {
 public:
     enum statementID {
@@ -25,7 +58,9 @@ public:
         GetSummary64k,
         LoadSampleBlock,
         InsertSampleBlock,
+        InsertSampleSummaries,
         DeleteSampleBlock,
+        DeleteSampleSummaries,
         GetSampleBlockSize,
         GetAllSampleBlocksSize
     };
@@ -45,15 +80,43 @@ private:
     std::atomic_bool mCheckpointActive {false};
     std::atomic_bool mCheckpointPending {false};
 
+    //checkpoint scheduling
+    std::atomic<size_t> mWalPages {0};
+    size_t mPageSize = 65536;
+    std::atomic<size_t> mBytesWritten {0};
+    std::atomic<float> mRecordPressure {0.0f};
+
+    size_t mRateBytes = 0;
+    std::chrono::steady_clock::time_point mRateTime;
+    double mWriteRate = 0;
+
+    std::mutex mMetricsMutex;
+    CheckpointMetrics mMetrics;
+
     std::mutex mStatementMutex;
     std::map<StatementIndex, sqlite3_stmt*> mStatements;
 
+    //read only connections, one per thread so reads from different threads dont queue up on mDB
+    std::mutex mReaderMutex;
+    std::map<std::thread::id, sqlite3*> mReaders;
+    //the profile mDB was last put in, readers get the same mmap and cache when they open
+    StorageProfile mReaderProfile;
+
     bool mTemp = false;
 
+    //bulk writes (importing) go in big transactions, writers hold this shared so a commit never lands mid insert
+    std::shared_mutex mBatchMutex;
+    std::atomic_bool mBatching {false};
+    std::atomic<size_t> mBatchBytes {0};
+
+    //inserts and commits that didnt make it to disk
+    std::atomic<size_t> mWriteFailures {0};
+
 public:
     DBConnection();
     ~DBConnection();
     sqlite3* DB();
+    sqlite3* ReadDB();
 
     sqlite3_stmt* Prepare(statementID id, const char* sql);
 
@@ -62,21 +125,71 @@ public:
 
     //sqlite mode setting
     int ModeConfig(sqlite3* db, const char* schema, const char* config);
-    int FastMode(const char* schema = "main");
-    int SafeMode(const char* schema = "main");
-    int setPageSize(const char* schema = "main");
+    int FastMode(const char* schema = "main", const StorageProfile& profile = sFastProfile);
+    int SafeMode(const char* schema = "main", const StorageProfile& profile = sSafeProfile);
+    int setPageSize(const char* schema = "main", int pageSize = sSafeProfile.pageSize);
 
     FilePath getPath() const {return mPath;}
 
     void setTemp(bool temp) {mTemp = temp;}
 
+    //How full the capture buffers are (0-1), checkpoints hold off while this is high
+    void setRecordPressure(float pressure) {mRecordPressure.store(pressure, std::memory_order_relaxed);}
+    float getRecordPressure() const {return mRecordPressure.load(std::memory_order_relaxed);}
+    void noteBytesWritten(size_t bytes) {
+        mBytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+        mBatchBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void noteWriteFailed() {mWriteFailures.fetch_add(1, std::memory_order_relaxed);}
+    //compare against an earlier value to see if anything since then failed to be written
+    size_t getWriteFailures() const {return mWriteFailures.load(std::memory_order_relaxed);}
+
+    //held by anything writing through mDB
+    std::shared_lock<std::shared_mutex> lockWrites() {return std::shared_lock<std::shared_mutex>(mBatchMutex);}
+    //everything written between these goes in transactions of about sBatchBytes instead of one per block
+    void beginBatch();
+    //commits and starts the next transaction once enough has gone in, call it between writes
+    void checkBatch();
+    //false if the last transaction didnt commit
+    bool endBatch();
+
+    CheckpointMetrics getCheckpointMetrics();
+
+    //STATIC MEMBERS
+    //profiles used by SafeMode/FastMode when none is passed in, SafeMode is what open uses
+    static StorageProfile sSafeProfile;
+    static StorageProfile sFastProfile;
+
+    static void setSafeProfile(const StorageProfile& profile) {sSafeProfile = profile;}
+    static void setFastProfile(const StorageProfile& profile) {sFastProfile = profile;}
+
+    //capture fill that starts deferring checkpoints, and the fill they resume under
+    static float sHighRecordPressure;
+    static float sLowRecordPressure;
+    //write rate (bytes/s) above which checkpoints wait for the disk to free up
+    static double sThrottleWriteRate;
+    //past this the checkpoint runs no matter what so the wal cant grow forever
+    static size_t sMaxWalBytes;
+    static std::chrono::milliseconds sMaxCheckpointDefer;
+    static size_t sBatchBytes;
+
 private:
     //Checkpoint Thread Stuff
     void checkpointThread(sqlite3* db, FilePath fileName);
     static int checkpointHook(void * data, sqlite3 * db, const char * schema, int pages);
+    bool shouldDeferCheckpoint(bool deferring, std::chrono::steady_clock::duration deferredFor);
+    double updateWriteRate();
 
     int openStepByStep(const FilePath fileName, bool newFile);
 
+    static bool isReadStatement(statementID id);
+    void closeReaders();
+
+    static std::string buildConfig(const StorageProfile& profile);
+    static std::string buildReaderConfig(const StorageProfile& profile);
+    int applyProfile(const char* schema, const StorageProfile& profile);
+
 
 
 
@@ -4,18 +4,95 @@
 
 #include "Exporter.h"
 
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <numeric>
 #include <stack>
 #include <wx/filedlg.h>
 #include <wx/translation.h>
 #include <wx/msw/filedlg.h>
 
 #include "../Visual/PlaybackHandler.h"
+#include "../Playback/AudioGraph/MixdownEngine.h"
 #include "File Types/WavFile.h"
+#include "../Audio/Dither.h"
+#include "../Audio/SampleKernels.h"
+#include "../Threading/BoundedQueue.h"
+#include "../Threading/ThreadPool.h"
 
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
 
 using namespace std;
 
+size_t Exporter::sMaxConcurrentExports = 4;
+bool Exporter::sDirectWrites = false;
+DitherType Exporter::sExportDither = DitherType::triangle;
+
+namespace {
+    //one chunk of a track on its way through the export pipeline
+    struct ExportChunk {
+        std::vector<std::vector<float>> channels;
+        //the channels after dithering down, only used when not exporting float
+        std::vector<std::vector<int>> converted;
+        std::vector<char> interleaved;
+        //where in the track it came from, only the range export needs it
+        sampleCount start = 0;
+        size_t samples = 0;
+    };
+
+    //one being read, one converted, one written and a spare so a stage never waits on a handoff
+    constexpr size_t kPipelineChunks = 4;
+
+    //adds the time it was alive for onto total
+    struct StageTimer {
+        std::atomic<uint64_t>& mTotal;
+        chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+
+        explicit StageTimer(std::atomic<uint64_t>& total) : mTotal(total) {}
+        ~StageTimer() {mTotal += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - mStart).count();}
+    };
+
+    //dithers down to format if its not float and interleaves len frames from offset on into dst
+    void interleaveChannels(const float* const* channels, size_t numChannels, size_t offset, size_t len, SampleFormat format,
+        DitherType ditherType, std::vector<Dither>& dithers, std::vector<std::vector<int>>& converted, std::vector<const void*>& planar, char* dst)
+    {
+        for (size_t i=0; i<numChannels; i++)
+        {
+            if (format == floatSample)
+            {
+                planar[i] = channels[i] + offset;
+            } else
+            {
+                dithers[i].Apply(ditherType, (constSamplePtr) (channels[i] + offset), floatSample, (samplePtr) converted[i].data(), format, len);
+                planar[i] = converted[i].data();
+            }
+        }
+
+        if (format == floatSample)
+        {
+            InterleaveFloats((const float* const*) planar.data(), numChannels, len, (float*) dst);
+        } else if (format == int16Sample)
+        {
+            InterleaveInt16((const short* const*) planar.data(), numChannels, len, (short*) dst);
+        } else
+        {
+            InterleaveInt24((const int* const*) planar.data(), numChannels, len, (unsigned char*) dst);
+        }
+    }
+
+    void interleaveChannels(const std::vector<std::vector<float>>& channels, size_t offset, size_t len, SampleFormat format,
+        DitherType ditherType, std::vector<Dither>& dithers, std::vector<std::vector<int>>& converted, std::vector<const void*>& planar, char* dst)
+    {
+        std::vector<const float*> sources(channels.size());
+        for (size_t i=0; i<channels.size(); i++)
+        {
+            sources[i] = channels[i].data();
+        }
+        interleaveChannels(sources.data(), channels.size(), offset, len, format, ditherType, dithers, converted, planar, dst);
+    }
+}
+
 string makeTime(size_t seconds) {
     int hours = seconds / 3600;
     int minutes = (seconds % 3600) / 60;
@@ -37,6 +114,7 @@ void Exporter::showExportUI()
                 cout<< "EXPORT MENU:\n"
                        "1 export wav (timestamp mode) \n"
                        "2 export wav (snapshot mode) \n"
+                       "3 export stereo mix \n"
                        "0 return\n"
                        ">> ";
 
@@ -49,6 +127,9 @@ void Exporter::showExportUI()
                     case 2:{
                         exportSnapshotsUI();
                     } break;
+                    case 3:{
+                        exportMixdownUI();
+                    } break;
                     case 0 :{
                         loop = false;
                     }break;
@@ -112,12 +193,32 @@ void Exporter::exportSnapshotsUI()
 
         PlaybackHandler::clrscr();
 
-        cout<<"Please enter the range of snapshots that you would like to export (valid input from 1-"<< mSnapshots.size() << "):\nenter -1 for full track or enter a single number for one snapshot \n>> ";
+        cout<<"Please enter the range of snapshots that you would like to export (valid input from 1-"<< mSnapshots.size() << "):\nenter -1 for full track, a single number for one snapshot or 0 for every snapshot in its own file \n>> ";
 
         string input;
         cin>>input;
         auto snapshotRange = get2Ints(input);
 
+        if (snapshotRange.first == 0)
+        {
+            mExportFormat = getExportFormat();
+
+            wxFileDialog exportFileDialog(nullptr, _("Choose Export Location"), "","", "Wav file (*.wav) | *.wav", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+            if (exportFileDialog.ShowModal() == wxID_CANCEL) {
+                cout<<"Canceled Export"<<endl;
+                PlaybackHandler::waitForKeyPress();
+                return;
+            }
+
+            //every file gets the snapshot name added on
+            FilePath path = exportFileDialog.GetPath();
+            path.erase(path.size()-4);
+
+            exportWavRanges(path, tracksToExport, getSnapshotRanges(tracksToExport));
+            return;
+        }
+
         sampleCount startLocation,endLocation;
         if (snapshotRange.first != -1)
         {
@@ -137,30 +238,36 @@ void Exporter::exportSnapshotsUI()
             endLocation = sampleCount(tracksToExport[0]->getLengthS()*tracksToExport[0]->GetRate());
         }
 
-        FilePath path;
+        exportTracks(tracksToExport, startLocation, endLocation);
+    } else {
+        cout<<"You have no snapshots to export with"<<endl;
+        PlaybackHandler::waitForKeyPress();
+    }
+}
 
-        wxFileDialog exportFileDialog(nullptr, _("Choose Export Location"), "","", "Wav file (*.wav) | *.wav", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+std::vector<ExportRange> Exporter::getSnapshotRanges(const Tracks& tracks)
+{
+    std::vector<ExportRange> ranges;
 
-        if (exportFileDialog.ShowModal() == wxID_CANCEL) {
-            cout<<"Canceled Export"<<endl;
-            PlaybackHandler::waitForKeyPress();
-            return;
-        }
+    const double rate = tracks[0]->GetRate();
+    const sampleCount trackEnd = sampleCount(tracks[0]->getLengthS()*rate);
 
-        if (tracksToExport.size() > 1)
-        {
-            path = exportFileDialog.GetPath();
-            path.erase(path.size()-4);
-        } else
+    for (size_t i = 0; i < mSnapshots.size(); ++i)
+    {
+        ExportRange range;
+        range.start = sampleCount(mSnapshots[i].timestamp*rate);
+        range.end = (i+1 < mSnapshots.size()) ? sampleCount(mSnapshots[i+1].timestamp*rate) : trackEnd;
+
+        //numbered so they sort in order, names can repeat
+        range.name = to_string(i+1);
+        if (!mSnapshots[i].name.empty())
         {
-            path = exportFileDialog.GetPath();
+            range.name += " " + mSnapshots[i].name;
         }
-
-        exportWavSamples(path, tracksToExport, startLocation, endLocation);
-    } else {
-        cout<<"You have no snapshots to export with"<<endl;
-        PlaybackHandler::waitForKeyPress();
+        ranges.push_back(range);
     }
+
+    return ranges;
 }
 
 void Exporter::exportTimestampsUI()
@@ -180,6 +287,43 @@ void Exporter::exportTimestampsUI()
         endLocation = sampleCount(mTracks[0]->GetRate()*mTracks[0]->getLengthS());
     }
 
+    exportTracks(tracksToExport, startLocation, endLocation);
+}
+
+void Exporter::exportMixdownUI()
+{
+    PlaybackHandler::clrscr();
+    cout<<"Please enter the time range for the mix (track length: "+makeTime(mTracks[0]->getLengthS())+")\nenter -1 for full track length\n>>";
+
+    auto timeRange = get2Times();
+    sampleCount startLocation, endLocation;
+    if (timeRange.first != -1){
+        startLocation = sampleCount(max(0.0, timeRange.first*mTracks[0]->GetRate()));
+        endLocation = sampleCount(min(timeRange.second*mTracks[0]->GetRate(), mTracks[0]->GetRate()*mTracks[0]->getLengthS()));
+    } else {
+        startLocation = 0;
+        endLocation = sampleCount(mTracks[0]->GetRate()*mTracks[0]->getLengthS());
+    }
+
+    mExportFormat = getExportFormat();
+
+    wxFileDialog exportFileDialog(nullptr, _("Choose Export Location"), "","", "Wav file (*.wav) | *.wav", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+    if (exportFileDialog.ShowModal() == wxID_CANCEL) {
+        cout<<"Canceled Export"<<endl;
+        PlaybackHandler::waitForKeyPress();
+        return;
+    }
+
+    exportMixdown(exportFileDialog.GetPath(), mTracks, startLocation, endLocation);
+    PlaybackHandler::waitForKeyPress();
+}
+
+void Exporter::exportTracks(Tracks tracks, sampleCount startLocation, sampleCount endLocation)
+{
+    const bool poly = tracks.size() > 1 && getPolyphonic();
+    mExportFormat = getExportFormat();
+
     FilePath path;
 
     wxFileDialog exportFileDialog(nullptr, _("Choose Export Location"), "","", "Wav file (*.wav) | *.wav", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
@@ -190,7 +334,7 @@ void Exporter::exportTimestampsUI()
         return;
     }
 
-    if (tracksToExport.size() > 1)
+    if (tracks.size() > 1 && !poly)
     {
         path = exportFileDialog.GetPath();
         path.erase(path.size()-4);
@@ -199,7 +343,47 @@ void Exporter::exportTimestampsUI()
         path = exportFileDialog.GetPath();
     }
 
-    exportWavSamples(path, tracksToExport, startLocation, endLocation);
+    if (poly)
+    {
+        exportPolyWav(path, tracks, startLocation, endLocation);
+    } else
+    {
+        exportWavSamples(path, tracks, startLocation, endLocation);
+    }
+}
+
+bool Exporter::getPolyphonic()
+{
+    PlaybackHandler::clrscr();
+    cout<<"Export as:\n"
+          "1 one file per track\n"
+          "2 one multichannel file\n"
+          ">> ";
+
+    int input;
+    cin>>input;
+
+    return input == 2;
+}
+
+SampleFormat Exporter::getExportFormat()
+{
+    PlaybackHandler::clrscr();
+    cout<<"Bit depth:\n"
+          "1 32 bit float\n"
+          "2 24 bit\n"
+          "3 16 bit\n"
+          ">> ";
+
+    int input;
+    cin>>input;
+
+    switch (input)
+    {
+        case 2: return int24Sample;
+        case 3: return int16Sample;
+        default: return floatSample;
+    }
 }
 
 std::pair<int, int> Exporter::get2Ints(std::string input)
@@ -267,60 +451,590 @@ size_t Exporter::parseTime(std::string time)
 
 void Exporter::exportWavSamples(FilePath path, Tracks tracks, sampleCount startLocation, sampleCount endLocation)
 {
-    if (tracks.size() == 1)
+    if (tracks.empty()) {
+        return;
+    }
+
+    const size_t length = (endLocation-startLocation).as_size_t();
+    const size_t totalFrames = length*tracks.size();
+
+    atomic<size_t> nextTrack {0};
+    atomic<size_t> tracksDone {0};
+    atomic<size_t> tracksFailed {0};
+    atomic<size_t> framesDone {0};
+
+    auto exportStart = chrono::steady_clock::now();
+
+    //each worker takes the next track until theyre all gone, so the concurrency is just the number of workers
+    auto& pool = ThreadPool::Get();
+    const size_t numWorkers = min({sMaxConcurrentExports, tracks.size(), max<size_t>(pool.size(), 1)});
+
+    vector<future<void>> exports;
+    exports.reserve(numWorkers);
+    for (size_t w = 0; w < numWorkers; ++w) {
+        exports.push_back(pool.submit([&] {
+            for (size_t i; (i = nextTrack++) < tracks.size();) {
+                auto& track = tracks[i];
+
+                FilePath trackPath = path;
+                if (tracks.size() > 1) {
+                    trackPath += " - ";
+                    trackPath += to_string(track->getTrackNum());
+                    trackPath += ".wav";
+                }
+
+                if (!exportWav(trackPath, {track}, startLocation, endLocation, &framesDone)) {
+                    tracksFailed++;
+                }
+                tracksDone++;
+            }
+        }));
+    }
+
+    for (auto& exportTask : exports) {
+        using namespace chrono;
+        while (exportTask.wait_for(500ms) != future_status::ready) {
+            if (mShowProgress) {
+                cout<<"\rExporting: "<<tracksDone.load()<<"/"<<tracks.size()<<" tracks done, "
+                    <<(totalFrames ? framesDone.load()*100/totalFrames : 100)<<"%   "<<flush;
+            }
+        }
+        exportTask.get();
+    }
+
+    if (tracksFailed > 0) {
+        cout<<"\r"<<tracksFailed.load()<<" of "<<tracks.size()<<" tracks failed to export"<<endl;
+    } else if (mShowProgress) {
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - exportStart).count();
+        cout<<"\rExported "<<tracks.size()<<" tracks in "<<secs<<"s ("<<(secs > 0 ? tracks.size()*60/secs : 0.0)
+            <<" tracks/min, "<<numWorkers<<" at a time)"<<endl;
+    }
+}
+
+void Exporter::exportPolyWav(FilePath path, Tracks tracks, sampleCount startLocation, sampleCount endLocation)
+{
+    if (tracks.empty()) {
+        return;
+    }
+
+    const size_t length = (endLocation-startLocation).as_size_t();
+    atomic<size_t> framesDone {0};
+
+    auto exportStart = chrono::steady_clock::now();
+
+    //theres only the one file, so its one task with the pipeline threads doing the work
+    auto exportTask = ThreadPool::Get().submit([&] {
+        return exportWav(path, tracks, startLocation, endLocation, &framesDone);
+    });
+
     {
-        exportWav(path, tracks[0], startLocation, endLocation);
+        using namespace chrono;
+        while (exportTask.wait_for(500ms) != future_status::ready) {
+            if (mShowProgress) {
+                cout<<"\rExporting: "<<(length ? framesDone.load()*100/length : 100)<<"%   "<<flush;
+            }
+        }
+        if (!exportTask.get()) {
+            return;
+        }
+    }
+
+    if (mShowProgress) {
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - exportStart).count();
+        cout<<"\rExported "<<tracks.size()<<" tracks to one file in "<<secs<<"s"<<endl;
     }
-    else
+}
+
+bool Exporter::exportWav(FilePath path, const Tracks& tracks, sampleCount startLocation, sampleCount endLocation, std::atomic<size_t>* progress)
+{
+    const size_t totalSamples = (endLocation-startLocation).as_size_t();
+
+    size_t numChannels = 0;
+    for (auto& track : tracks)
     {
-        for (auto track : tracks)
+        //TRACKS IN ONE FILE HAVE TO SHARE A RATE
+        wxASSERT(track->GetRate() == tracks[0]->GetRate());
+        numChannels += track->NChannels();
+    }
+
+    const auto format = mExportFormat;
+    WavFile wavFile(tracks[0]->GetRate(), numChannels, format, totalSamples);
+
+    if (tracks.size() > 1)
+    {
+        //tracks arent speakers, no mask tells the DAW to bring them in as separate channels
+        wavFile.setChannelMask(0);
+
+        std::vector<std::string> names;
+        for (auto& track : tracks)
         {
-            FilePath newPath = path+" - ";
-            newPath += to_string(track->getTrackNum());
-            newPath += ".wav";
+            for (size_t i=0; i<track->NChannels(); i++)
+            {
+                string name = "Track " + to_string(track->getTrackNum());
+                if (track->NChannels() > 1)
+                {
+                    name += (i == 0) ? " L" : (i == 1) ? " R" : " " + to_string(i+1);
+                }
+                names.push_back(name);
+            }
+        }
+        wavFile.setChannelNames(names);
+    }
 
-            exportWav(newPath, track, startLocation, endLocation);
+    if (!wavFile.openWavFile(path, sDirectWrites))
+    {
+        cout<<"Failed to export "<<path<<endl;
+        if (wavFile.isOpen())
+        {
+            wavFile.closeWavFile();
+        }
+        return false;
+    }
+
+    //chunks get shorter as the channels go up so a wide poly file doesnt hold gigabytes in the pipeline
+    size_t samplesPerBlock = std::max<size_t>(mBlockSize/(SAMPLE_SIZE(tracks[0]->GetSampleFormat())*numChannels), 16384);
+
+    //** MEMORY ALLOCATIONS **
+    std::vector<ExportChunk> chunks(kPipelineChunks);
+    for (auto& chunk : chunks)
+    {
+        chunk.channels.assign(numChannels, std::vector<float>(samplesPerBlock));
+        if (format != floatSample)
+        {
+            chunk.converted.assign(numChannels, std::vector<int>(samplesPerBlock));
         }
+        chunk.interleaved.resize(numChannels*samplesPerBlock*WavFile::BytesPerSample(format));
     }
+
+    //one per channel for the whole file, so the noise shaping carries on from chunk to chunk
+    std::vector<Dither> dithers(numChannels);
+
+    //one cursor per channel so each chunk carries on from the last instead of searching for it
+    std::vector<std::unique_ptr<SequenceReader>> readers;
+    for (auto& track : tracks)
+    {
+        for (size_t i=0; i<track->NChannels(); i++)
+        {
+            readers.push_back(track->makeReader(i));
+            readers.back()->Seek(startLocation);
+        }
+    }
+    //** END OF MEMORY ALLOCATIONS **
+
+    //chunks go read -> convert -> write -> back to free, each stage on its own thread so none of them wait on the others
+    BoundedQueue<ExportChunk*> freeChunks(kPipelineChunks);
+    BoundedQueue<ExportChunk*> toConvert(kPipelineChunks);
+    BoundedQueue<ExportChunk*> toWrite(kPipelineChunks);
+    for (auto& chunk : chunks)
+    {
+        freeChunks.push(&chunk);
+    }
+
+    std::thread readThread([&]
+    {
+        size_t samplesRemaining = totalSamples;
+        while (samplesRemaining>0)
+        {
+            auto chunk = freeChunks.pop();
+            if (!chunk)
+            {
+                break;
+            }
+
+            auto& c = **chunk;
+            c.samples = std::min(samplesRemaining, samplesPerBlock);
+            {
+                StageTimer timer(mReadNanos);
+                for (size_t i=0; i<numChannels; i++)
+                {
+                    readers[i]->Read((samplePtr) c.channels[i].data(), floatSample, c.samples);
+                }
+            }
+
+            samplesRemaining -= c.samples;
+            toConvert.push(*chunk);
+        }
+        toConvert.close();
+    });
+
+    std::thread convertThread([&]
+    {
+        std::vector<const void*> planar(numChannels);
+        while (auto chunk = toConvert.pop())
+        {
+            auto& c = **chunk;
+            {
+                StageTimer timer(mConvertNanos);
+                interleaveChannels(c.channels, 0, c.samples, format, sExportDither, dithers, c.converted, planar, c.interleaved.data());
+            }
+            toWrite.push(*chunk);
+        }
+        toWrite.close();
+    });
+
+    //writes stay on this thread
+    bool failed = false;
+    while (auto chunk = toWrite.pop())
+    {
+        auto& c = **chunk;
+        StageTimer timer(mWriteNanos);
+        if (!wavFile.writeSamples((constSamplePtr) c.interleaved.data(), c.samples))
+        {
+            failed = true;
+            break;
+        }
+
+        if (progress) {
+            *progress += c.samples;
+        }
+
+        freeChunks.push(*chunk);
+    }
+
+    //if the write failed this lets the other stages out early
+    freeChunks.close();
+    toConvert.close();
+    toWrite.close();
+    readThread.join();
+    convertThread.join();
+
+    //the last flush and the header going back in count as writing too
+    {
+        StageTimer timer(mWriteNanos);
+        if (!wavFile.closeWavFile())
+        {
+            failed = true;
+        }
+    }
+
+    if (failed)
+    {
+        cout<<"Failed to export "<<path<<endl;
+        return false;
+    }
+    return true;
 }
 
-void Exporter::exportWav(FilePath path, std::shared_ptr<Track> track, sampleCount startLocation, sampleCount endLocation)
+void Exporter::exportWavRanges(FilePath path, Tracks tracks, std::vector<ExportRange> ranges)
 {
-    size_t samplesRemaining = (endLocation-startLocation).as_size_t();
-    sampleCount location = startLocation;
+    //nothing to write for an empty range, and the sweep assumes every range has something in it
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [](const ExportRange& range) {return range.end <= range.start;}), ranges.end());
+    if (tracks.empty() || ranges.empty()) {
+        return;
+    }
+
+    size_t totalFrames = 0;
+    for (auto& range : ranges) {
+        totalFrames += (range.end - range.start).as_size_t()*tracks.size();
+    }
+
+    atomic<size_t> nextTrack {0};
+    atomic<size_t> tracksDone {0};
+    atomic<size_t> tracksFailed {0};
+    atomic<size_t> framesDone {0};
+
+    auto exportStart = chrono::steady_clock::now();
 
-    WavFile wavFile(track->GetRate(), track->NChannels(), track->GetSampleFormat(), (endLocation-startLocation).as_size_t());
+    //same as exportWavSamples, a worker per track and each one writes all of that tracks ranges
+    auto& pool = ThreadPool::Get();
+    const size_t numWorkers = min({sMaxConcurrentExports, tracks.size(), max<size_t>(pool.size(), 1)});
 
-    wavFile.openWavFile(path);
+    vector<future<void>> exports;
+    exports.reserve(numWorkers);
+    for (size_t w = 0; w < numWorkers; ++w) {
+        exports.push_back(pool.submit([&] {
+            for (size_t i; (i = nextTrack++) < tracks.size();) {
+                if (!exportTrackRanges(path, tracks[i], ranges, tracks.size() > 1, &framesDone)) {
+                    tracksFailed++;
+                }
+                tracksDone++;
+            }
+        }));
+    }
 
-    size_t samplesPerBlock = mBlockSize/SAMPLE_SIZE(track->GetSampleFormat());
+    for (auto& exportTask : exports) {
+        using namespace chrono;
+        while (exportTask.wait_for(500ms) != future_status::ready) {
+            if (mShowProgress) {
+                cout<<"\rExporting: "<<tracksDone.load()<<"/"<<tracks.size()<<" tracks done, "
+                    <<(totalFrames ? framesDone.load()*100/totalFrames : 100)<<"%   "<<flush;
+            }
+        }
+        exportTask.get();
+    }
+
+    if (tracksFailed > 0) {
+        cout<<"\rSome ranges of "<<tracksFailed.load()<<" of "<<tracks.size()<<" tracks failed to export"<<endl;
+    } else if (mShowProgress) {
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - exportStart).count();
+        cout<<"\rExported "<<ranges.size()<<" ranges of "<<tracks.size()<<" tracks in "<<secs<<"s"<<endl;
+    }
+}
+
+bool Exporter::exportTrackRanges(FilePath path, std::shared_ptr<Track> track, const std::vector<ExportRange>& ranges, bool nameByTrack, std::atomic<size_t>* progress)
+{
+    const size_t numChannels = track->NChannels();
+    const auto format = mExportFormat;
+
+    //ranges in the order the sweep gets to them
+    std::vector<size_t> order(ranges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {return ranges[a].start < ranges[b].start;});
+
+    sampleCount sweepEnd = 0;
+    for (auto& range : ranges)
+    {
+        sweepEnd = std::max(sweepEnd, range.end);
+    }
+
+    //a file is only open while the sweep is inside its range
+    struct RangeOutput {
+        std::unique_ptr<WavFile> file;
+        std::vector<Dither> dithers;
+        //couldnt be opened or a write failed, the rest of the range is skipped
+        bool failed = false;
+    };
+    std::vector<RangeOutput> outputs(ranges.size());
+    size_t numFailed = 0;
+
+    size_t samplesPerBlock = std::max<size_t>(mBlockSize/(SAMPLE_SIZE(track->GetSampleFormat())*numChannels), 16384);
 
     //** MEMORY ALLOCATIONS **
-    std::vector<std::vector<float>>tempBufs (track->NChannels(), std::vector<float>(samplesPerBlock));
+    std::vector<ExportChunk> chunks(kPipelineChunks);
+    for (auto& chunk : chunks)
+    {
+        chunk.channels.assign(numChannels, std::vector<float>(samplesPerBlock));
+    }
+
+    //the same chunk gets cut up for every range it overlaps, so converting happens on the write side
+    std::vector<std::vector<int>> converted;
+    if (format != floatSample)
+    {
+        converted.assign(numChannels, std::vector<int>(samplesPerBlock));
+    }
+    std::vector<char> interleaved(numChannels*samplesPerBlock*WavFile::BytesPerSample(format));
+    std::vector<const void*> planar(numChannels);
 
-    std::vector<float> outputBufs;
-    outputBufs.resize(track->NChannels()*samplesPerBlock);
+    std::vector<std::unique_ptr<SequenceReader>> readers;
+    for (size_t i=0; i<numChannels; i++)
+    {
+        readers.push_back(track->makeReader(i));
+    }
     //** END OF MEMORY ALLOCATIONS **
 
-    while (samplesRemaining>0)
+    BoundedQueue<ExportChunk*> freeChunks(kPipelineChunks);
+    BoundedQueue<ExportChunk*> toWrite(kPipelineChunks);
+    for (auto& chunk : chunks)
     {
-        size_t samples = std::min(samplesRemaining, samplesPerBlock);
+        freeChunks.push(&chunk);
+    }
 
-        for (size_t i=0; i<track->NChannels(); i++)
+    //one pass front to back, overlapping ranges share the reads and gaps nobody wants are skipped
+    std::thread readThread([&]
+    {
+        sampleCount pos = ranges[order[0]].start;
+        sampleCount reach = pos;
+        size_t next = 0;
+
+        while (pos < sweepEnd)
+        {
+            while (next < order.size() && ranges[order[next]].start <= pos)
+            {
+                reach = std::max(reach, ranges[order[next++]].end);
+            }
+            if (reach <= pos)
+            {
+                pos = ranges[order[next]].start;
+                continue;
+            }
+
+            auto chunk = freeChunks.pop();
+            if (!chunk)
+            {
+                break;
+            }
+
+            auto& c = **chunk;
+            c.start = pos;
+            c.samples = std::min(samplesPerBlock, (reach - pos).as_size_t());
+            for (size_t i=0; i<numChannels; i++)
+            {
+                readers[i]->Read((samplePtr) c.channels[i].data(), floatSample, pos, c.samples);
+            }
+
+            pos += c.samples;
+            toWrite.push(*chunk);
+        }
+        toWrite.close();
+    });
+
+    while (auto chunk = toWrite.pop())
+    {
+        auto& c = **chunk;
+        const sampleCount chunkEnd = c.start + c.samples;
+
+        for (size_t r=0; r<ranges.size(); r++)
+        {
+            const auto& range = ranges[r];
+            const sampleCount start = std::max(range.start, c.start);
+            const sampleCount end = std::min(range.end, chunkEnd);
+            if (start >= end)
+            {
+                continue;
+            }
+
+            const size_t len = (end - start).as_size_t();
+            auto& out = outputs[r];
+            if (!out.file && !out.failed)
+            {
+                FilePath rangePath = path;
+                rangePath += " - ";
+                rangePath += range.name;
+                if (nameByTrack)
+                {
+                    rangePath += " - ";
+                    rangePath += to_string(track->getTrackNum());
+                }
+                rangePath += ".wav";
+
+                out.file = std::make_unique<WavFile>(track->GetRate(), numChannels, format, (range.end - range.start).as_size_t());
+                out.dithers.resize(numChannels);
+                if (!out.file->openWavFile(rangePath, sDirectWrites))
+                {
+                    if (out.file->isOpen())
+                    {
+                        out.file->closeWavFile();
+                    }
+                    out.file.reset();
+                    out.failed = true;
+                    numFailed++;
+                    cout<<"Failed to export range "<<range.name<<endl;
+                }
+            }
+
+            if (progress) {
+                *progress += len;
+            }
+            if (out.failed)
+            {
+                continue;
+            }
+
+            interleaveChannels(c.channels, (start - c.start).as_size_t(), len, format, sExportDither, out.dithers, converted, planar, interleaved.data());
+            const bool written = out.file->writeSamples((constSamplePtr) interleaved.data(), len);
+            if (!written)
+            {
+                out.failed = true;
+                numFailed++;
+                cout<<"Failed to export range "<<range.name<<endl;
+            }
+
+            if (!written || end == range.end)
+            {
+                if (!out.file->closeWavFile() && written)
+                {
+                    out.failed = true;
+                    numFailed++;
+                    cout<<"Failed to export range "<<range.name<<endl;
+                }
+                out.file.reset();
+            }
+        }
+
+        freeChunks.push(*chunk);
+
+        //nothing left worth reading for
+        if (numFailed == ranges.size())
         {
-            track->GetFloats(i, (samplePtr) tempBufs[i].data(), location, samples);
+            break;
+        }
+    }
+
+    //lets the read thread out early if everything failed
+    freeChunks.close();
+    toWrite.close();
+    readThread.join();
+
+    return numFailed == 0;
+}
+
+void Exporter::exportMixdown(FilePath path, const Tracks& tracks, sampleCount startLocation, sampleCount endLocation)
+{
+    if (tracks.empty()) {
+        return;
+    }
 
-            for (size_t j=0; j<samples; j++)
+    AudioGraph::MixdownEngine engine(tracks);
+    if (engine.numSources() == 0) {
+        cout<<"Every track is muted, nothing to mix"<<endl;
+        return;
+    }
+
+    const size_t totalSamples = (endLocation-startLocation).as_size_t();
+    const auto format = mExportFormat;
+    const double rate = tracks[0]->GetRate();
+
+    WavFile wavFile(rate, 2, format, totalSamples);
+    if (!wavFile.openWavFile(path, sDirectWrites))
+    {
+        cout<<"Failed to export mix to "<<path<<endl;
+        if (wavFile.isOpen())
+        {
+            wavFile.closeWavFile();
+        }
+        return;
+    }
+
+    //the sink is only ever called on one thread so this can all be shared
+    std::vector<Dither> dithers(2);
+    std::vector<std::vector<int>> converted;
+    std::vector<char> interleaved;
+    std::vector<const void*> planar(2);
+
+    size_t written = 0;
+    auto mixStart = chrono::steady_clock::now();
+    auto lastProgress = mixStart;
+
+    bool ok = engine.render(startLocation, endLocation, [&](const float* const* channels, size_t samples)
+    {
+        //the engine never hands over more than a block so these stop growing after the first call
+        if (format != floatSample)
+        {
+            converted.resize(2);
+            for (auto& channel : converted)
             {
-                outputBufs[track->NChannels()*j + i] = tempBufs[i][j];
+                channel.resize(std::max(channel.size(), samples));
             }
         }
+        interleaved.resize(std::max(interleaved.size(), 2*samples*WavFile::BytesPerSample(format)));
 
-        wavFile.writeSamples((constSamplePtr) outputBufs.data(), samples);
+        interleaveChannels(channels, 2, 0, samples, format, sExportDither, dithers, converted, planar, interleaved.data());
+        if (!wavFile.writeSamples((constSamplePtr) interleaved.data(), samples))
+        {
+            return false;
+        }
 
-        samplesRemaining -= samples;
-        location += samples;
+        written += samples;
+        auto now = chrono::steady_clock::now();
+        if (mShowProgress && now - lastProgress > chrono::milliseconds(500))
+        {
+            cout<<"\rMixing: "<<(totalSamples ? written*100/totalSamples : 100)<<"%   "<<flush;
+            lastProgress = now;
+        }
+        return true;
+    });
+
+    if (!wavFile.closeWavFile())
+    {
+        ok = false;
     }
 
-    wavFile.closeWavFile();
-}
\ No newline at end of file
+    if (!ok)
+    {
+        cout<<"Failed to export mix to "<<path<<endl;
+    } else if (mShowProgress)
+    {
+        const double secs = chrono::duration<double>(chrono::steady_clock::now() - mixStart).count();
+        cout<<"\rMixed "<<engine.numSources()<<" tracks in "<<secs<<"s ("<<(secs > 0 ? totalSamples/rate/secs : 0.0)<<"x real time)"<<endl;
+    }
+}
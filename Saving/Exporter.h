@@ -4,6 +4,9 @@
 
 #ifndef EXPORTER_H
 #define EXPORTER_H
+#include <atomic>
+
+#include "../Audio/Dither.h"
 #include "../Audio/SampleFormat.h"
 #include "../Midi/Snapshots.h"
 #include "../Playback/Track.h"
@@ -13,6 +16,20 @@ enum exportFormat {
     //Mp3Format = 1
 };
 
+//part of a track to go out as its own file, name gets added on to the export path
+struct ExportRange {
+    sampleCount start;
+    sampleCount end;
+    std::string name;
+};
+
+//seconds each stage of exportWav spent working (not waiting on the others), added up over every file
+struct ExportStageTimes {
+    double read = 0;
+    double convert = 0;
+    double write = 0;
+};
+
 class Exporter
 {
     exportFormat mFormat;
@@ -25,6 +42,22 @@ class Exporter
 
     size_t mSamplesPerBlock;
 
+    bool mShowProgress = true;
+
+    std::atomic<uint64_t> mReadNanos {0};
+    std::atomic<uint64_t> mConvertNanos {0};
+    std::atomic<uint64_t> mWriteNanos {0};
+
+    //what the wav files get written as, anything narrower than float gets dithered
+    SampleFormat mExportFormat = floatSample;
+
+    //STATIC MEMBERS
+    //stems written at once, past what the disk can keep up with they all just get slower
+    static size_t sMaxConcurrentExports;
+    //write the wav files around the page cache, exports are written once and not read back
+    static bool sDirectWrites;
+    static DitherType sExportDither;
+
 public:
     Exporter()
         : mFormat() {
@@ -35,22 +68,51 @@ public:
         showExportUI();
     }
 
+    //tracks go out concurrently on the thread pool, up to sMaxConcurrentExports at a time
+    void exportWavSamples(FilePath path, Tracks tracks, sampleCount startLocation, sampleCount endLocation);
+    //every channel of every track interleaved into one wav, read together in a single pass
+    void exportPolyWav(FilePath path, Tracks tracks, sampleCount startLocation, sampleCount endLocation);
+    //a file per range per track, each track is read once front to back however many ranges there are
+    void exportWavRanges(FilePath path, Tracks tracks, std::vector<ExportRange> ranges);
+    //stereo mix of the tracks with their gain, pan, mute and solo, see AudioGraph::MixdownEngine
+    void exportMixdown(FilePath path, const Tracks& tracks, sampleCount startLocation, sampleCount endLocation);
+
+    void setShowProgress(bool show) {mShowProgress = show;}
+
+    ExportStageTimes getStageTimes() const {return {mReadNanos*1e-9, mConvertNanos*1e-9, mWriteNanos*1e-9};}
+    void resetStageTimes() {mReadNanos = 0; mConvertNanos = 0; mWriteNanos = 0;}
+    void setExportFormat(SampleFormat format) {mExportFormat = format;}
+
+    static void setMaxConcurrentExports(size_t max) {sMaxConcurrentExports = std::max<size_t>(max, 1);}
+    static size_t getMaxConcurrentExports() {return sMaxConcurrentExports;}
+    static void setDirectWrites(bool direct) {sDirectWrites = direct;}
+    //shaped sounds best but cant be vectorized, triangle is the default
+    static void setExportDither(DitherType type) {sExportDither = type;}
+
 private:
     void showExportUI();
 
     void exportSnapshotsUI();
     void exportTimestampsUI();
+    void exportMixdownUI();
 
     Tracks getTracksToExport();
+    SampleFormat getExportFormat();
+    bool getPolyphonic();
+    void exportTracks(Tracks tracks, sampleCount startLocation, sampleCount endLocation);
 
     size_t parseTime(std::string time);
 
     std::pair<int,int> get2Ints(std::string input);
     std::pair<double, double> get2Times();
 
-    void exportWavSamples(FilePath path, Tracks tracks, sampleCount startLocation, sampleCount endLocation);
-    void exportWavSnapshot(FilePath path, Tracks tracks, int startSnapshot, int endSnapshot);
+    //every snapshot to the next one as its own file
+    std::vector<ExportRange> getSnapshotRanges(const Tracks& tracks);
+    //false if any of the ranges failed
+    bool exportTrackRanges(FilePath path, std::shared_ptr<Track> track, const std::vector<ExportRange>& ranges, bool nameByTrack, std::atomic<size_t>* progress);
 
-    void exportWav(FilePath path, std::shared_ptr<Track> track, sampleCount startLocation, sampleCount endLocation);
+    //all the tracks channels go in the one file, one after the other
+    //progress gets the number of frames written added to it as the export goes, false if the file didnt get written
+    bool exportWav(FilePath path, const Tracks& tracks, sampleCount startLocation, sampleCount endLocation, std::atomic<size_t>* progress = nullptr);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "AlignedFileWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+size_t AlignedFileWriter::sDefaultBufferBytes = 4*1024*1024;
+
+AlignedFileWriter::~AlignedFileWriter() {
+    if (mOpen) {
+        close();
+    }
+}
+
+bool AlignedFileWriter::open(const FilePath &path, bool direct, size_t bufferBytes) {
+    if (mOpen) {
+        close();
+    }
+
+    mBufferSize = std::max(sAlignment, (bufferBytes + sAlignment - 1)/sAlignment*sAlignment);
+    mStorage.resize(mBufferSize + sAlignment);
+    //unbuffered io needs the memory aligned too, not just the file offsets
+    auto address = reinterpret_cast<uintptr_t>(mStorage.data());
+    mBuffer = mStorage.data() + (sAlignment - address%sAlignment)%sAlignment;
+
+    mFill = 0;
+    mSize = 0;
+    mFailed = false;
+
+#if defined _WIN32
+    auto openFile = [&](bool unbuffered) {
+        DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+        if (unbuffered) {
+            flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+        }
+        HANDLE handle = CreateFileW(path.wc_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, flags, nullptr);
+        return handle == INVALID_HANDLE_VALUE ? nullptr : (void*)handle;
+    };
+#else
+    auto openFile = [&](bool unbuffered) {
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    #if defined O_DIRECT
+        if (unbuffered) {
+            flags |= O_DIRECT;
+        }
+    #else
+        if (unbuffered) {
+            return -1;
+        }
+    #endif
+        return ::open(path.ToUTF8(), flags, 0644);
+    };
+#endif
+
+    mDirect = direct;
+    mFile = openFile(mDirect);
+    if (mDirect && !validHandle()) {
+        //some filesystems (tmpfs, network shares) wont do unbuffered io, its only an optimization anyway
+        std::cerr<<"Unbuffered writes not supported for "<<path<<", using the page cache"<<std::endl;
+        mDirect = false;
+        mFile = openFile(false);
+    }
+    mOpen = validHandle();
+
+    if (!mOpen) {
+        //FAILED TO OPEN EXPORT FILE
+        mFailed = true;
+        std::cerr<<"Failed to open "<<path<<" for writing"<<std::endl;
+    }
+    return mOpen;
+}
+
+bool AlignedFileWriter::write(const void *src, size_t bytes) {
+    if (!mOpen || mFailed) {
+        return false;
+    }
+
+    auto in = static_cast<const char*>(src);
+    mSize += bytes;
+
+    while (bytes > 0) {
+        const auto toCopy = std::min(bytes, mBufferSize - mFill);
+        memcpy(mBuffer + mFill, in, toCopy);
+        mFill += toCopy;
+        in += toCopy;
+        bytes -= toCopy;
+
+        if (mFill == mBufferSize && !flushBuffer(mBufferSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AlignedFileWriter::close() {
+    if (!mOpen) {
+        return false;
+    }
+
+    bool ok = !mFailed;
+    if (ok && mFill > 0) {
+        if (mDirect) {
+            //the last write still has to be a whole number of sectors, the padding gets cut off below
+            const auto padded = (mFill + sAlignment - 1)/sAlignment*sAlignment;
+            memset(mBuffer + mFill, 0, padded - mFill);
+            ok = flushBuffer(padded) && truncate(mSize);
+        } else {
+            ok = flushBuffer(mFill);
+        }
+    }
+
+    closeHandle();
+
+    mStorage.clear();
+    mStorage.shrink_to_fit();
+    mBuffer = nullptr;
+
+    return ok;
+}
+
+bool AlignedFileWriter::flushBuffer(size_t bytes) {
+    size_t written = 0;
+    while (written < bytes) {
+#if defined _WIN32
+        DWORD result = 0;
+        if (!WriteFile((HANDLE)mFile, mBuffer + written, (DWORD)(bytes - written), &result, nullptr)) {
+            result = 0;
+        }
+#else
+        auto result = ::write(mFile, mBuffer + written, bytes - written);
+#endif
+        if (result <= 0) {
+            //DISK FULL OR THE FILE WENT AWAY
+            std::cerr<<"Export write failed"<<std::endl;
+            mFailed = true;
+            return false;
+        }
+        written += result;
+    }
+
+    mFill = 0;
+    return true;
+}
+
+bool AlignedFileWriter::truncate(uint64_t size) {
+#if defined _WIN32
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)size;
+    return SetFilePointerEx((HANDLE)mFile, pos, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE)mFile);
+#else
+    return ftruncate(mFile, (off_t)size) == 0;
+#endif
+}
+
+bool AlignedFileWriter::validHandle() const {
+#if defined _WIN32
+    return mFile != nullptr;
+#else
+    return mFile >= 0;
+#endif
+}
+
+void AlignedFileWriter::closeHandle() {
+#if defined _WIN32
+    CloseHandle((HANDLE)mFile);
+    mFile = nullptr;
+#else
+    ::close(mFile);
+    mFile = -1;
+#endif
+    mOpen = false;
+}
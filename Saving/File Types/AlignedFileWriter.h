@@ -0,0 +1,69 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef ALIGNEDFILEWRITER_H
+#define ALIGNEDFILEWRITER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../DBConnection.h"
+
+//Sequential file writer that only ever hands the os large, sector aligned writes. With direct set it skips
+//the page cache too (FILE_FLAG_NO_BUFFERING / O_DIRECT), the tail gets padded out to the alignment on close
+//and then cut back to the real size
+class AlignedFileWriter {
+#if defined _WIN32
+    void* mFile = nullptr;
+#else
+    int mFile = -1;
+#endif
+    bool mOpen = false;
+    bool mDirect = false;
+
+    std::vector<char> mStorage;
+    char* mBuffer = nullptr;
+    size_t mBufferSize = 0;
+    size_t mFill = 0;
+
+    //bytes handed to write so far, what the file gets truncated to
+    uint64_t mSize = 0;
+    bool mFailed = false;
+
+public:
+    AlignedFileWriter() = default;
+    ~AlignedFileWriter();
+
+    AlignedFileWriter(const AlignedFileWriter&) = delete;
+    AlignedFileWriter& operator=(const AlignedFileWriter&) = delete;
+
+    //falls back to normal buffered writes if the os wont open the file unbuffered
+    bool open(const FilePath& path, bool direct, size_t bufferBytes = sDefaultBufferBytes);
+    bool write(const void* src, size_t bytes);
+    bool close();
+
+    bool isOpen() const {return mOpen;}
+    bool isDirect() const {return mDirect;}
+    bool failed() const {return mFailed;}
+    uint64_t size() const {return mSize;}
+
+    //STATIC MEMBERS
+    //covers the sector size of anything we're likely to write to
+    static constexpr size_t sAlignment = 4096;
+    static size_t sDefaultBufferBytes;
+
+private:
+    bool flushBuffer(size_t bytes);
+    bool truncate(uint64_t size);
+    bool validHandle() const;
+    void closeHandle();
+};
+
+
+
+#endif //ALIGNEDFILEWRITER_H
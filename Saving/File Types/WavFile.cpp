@@ -4,35 +4,190 @@
 
 #include "WavFile.h"
 
-void WavFile::openWavFile(FilePath wavFilePath)
+bool WavFile::openWavFile(FilePath wavFilePath, bool direct)
 {
     mWavFilePath = wavFilePath;
 
-    mWavFile = ofstream(std::string(wavFilePath), ios::binary);
+    if (!mWavFile.open(wavFilePath, direct))
+    {
+        return false;
+    }
 
     mConnected = true;
     mWrittenSamples = 0;
 
     writeHeader();
+    return !mWavFile.failed();
 }
 
-void WavFile::closeWavFile()
+bool WavFile::closeWavFile()
 {
-    assert(mConnected && mNumSamples == mWrittenSamples);
+    //a failed write leaves the file short
+    assert(mConnected && (mNumSamples == mWrittenSamples || mWavFile.failed()));
     mConnected = false;
-    mWavFile.close();
+
+    //chunks have to be an even number of bytes, the pad isnt counted in the data size
+    const uint64_t dataBytes = uint64_t(mWrittenSamples)*mHeader.blockAlign;
+    if (dataBytes % 2) {
+        const char pad = 0;
+        mWavFile.write(&pad, 1);
+    }
+
+    if (!mWavFile.close()) {
+        //FAILED TO FLUSH, THE REAL SIZES WOULD CLAIM AUDIO THAT ISNT THERE
+        cerr<<"Failed to write the end of "<<mWavFilePath<<endl;
+        return false;
+    }
+
+    return finalizeHeader();
 }
 
-void WavFile::writeSamples(constSamplePtr src, size_t numSamples)
+bool WavFile::writeSamples(constSamplePtr src, size_t numSamples)
 {
     assert(mConnected);
 
-    mWavFile.write(src, numSamples*mHeader.blockAlign); //Pray this works :), note: originally didnt work :(
+    if (!mWavFile.write(src, uint64_t(numSamples)*mHeader.blockAlign)) //Pray this works :), note: originally didnt work :(
+    {
+        return false;
+    }
 
     mWrittenSamples += numSamples;
+    return true;
 }
 
 void WavFile::writeHeader()
 {
-    mWavFile.write(reinterpret_cast<char*>(&mHeader),sizeof(mHeader));
+    auto header = buildHeader(uint64_t(mNumSamples)*mHeader.blockAlign, mNumSamples);
+    mWavFile.write(header.data(), header.size());
+}
+
+bool WavFile::finalizeHeader()
+{
+    //the file is written unbuffered and in big aligned pieces, simplest to go back in through a normal stream
+    auto header = buildHeader(uint64_t(mWrittenSamples)*mHeader.blockAlign, mWrittenSamples);
+
+    fstream file(std::string(mWavFilePath.ToUTF8()), ios::in | ios::out | ios::binary);
+    if (!file) {
+        //FAILED TO REOPEN, HEADER STILL HAS THE PROJECTED SIZE
+        cerr<<"Failed to finalize "<<mWavFilePath<<endl;
+        return false;
+    }
+
+    file.seekp(0);
+    file.write(header.data(), header.size());
+    file.close();
+
+    if (!file) {
+        //FAILED TO WRITE THE HEADER
+        cerr<<"Failed to finalize "<<mWavFilePath<<endl;
+        return false;
+    }
+    return true;
+}
+
+void WavFile::setChannelNames(const std::vector<std::string>& names)
+{
+    assert(!mConnected);
+
+    auto escape = [](const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            switch (c) {
+                case '&': out += "&amp;"; break;
+                case '<': out += "&lt;"; break;
+                case '>': out += "&gt;"; break;
+                default: out += c;
+            }
+        }
+        return out;
+    };
+
+    //the bits of iXML DAWs actually read when naming the channels of a poly file
+    mIXML = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<BWFXML><IXML_VERSION>1.61</IXML_VERSION><TRACK_LIST>";
+    mIXML += "<TRACK_COUNT>" + to_string(names.size()) + "</TRACK_COUNT>";
+    for (size_t i = 0; i < names.size(); ++i) {
+        mIXML += "<TRACK><CHANNEL_INDEX>" + to_string(i+1) + "</CHANNEL_INDEX><INTERLEAVE_INDEX>" + to_string(i+1)
+               + "</INTERLEAVE_INDEX><NAME>" + escape(names[i]) + "</NAME></TRACK>";
+    }
+    mIXML += "</TRACK_LIST></BWFXML>";
+
+    if (mIXML.size() % 2) {
+        mIXML += '\0';
+    }
+    mExtensible = true;
+}
+
+uint64_t WavFile::headerBytes() const
+{
+    //RIFF + JUNK/ds64 + fmt + iXML + data chunk header
+    return 12 + (8+28) + (8 + (mExtensible ? 40 : 16)) + (mIXML.empty() ? 0 : 8 + mIXML.size()) + 8;
+}
+
+bool WavFile::NeedsRF64(uint64_t dataBytes) const
+{
+    //everything after the RIFF size field has to fit in 32 bits
+    const uint64_t riffSize = headerBytes() - 8 + dataBytes + (dataBytes % 2);
+    return riffSize > sRiffLimit;
+}
+
+std::vector<char> WavFile::buildHeader(uint64_t dataBytes, uint64_t numFrames) const
+{
+    std::vector<char> header;
+    header.reserve(headerBytes());
+
+    auto putTag = [&](const char* tag) {header.insert(header.end(), tag, tag+4);};
+    auto putInt = [&](uint64_t value, int bytes) {
+        //wav is little endian whatever we're running on
+        for (int i = 0; i < bytes; ++i) {
+            header.push_back(char((value >> (8*i)) & 0xff));
+        }
+    };
+
+    const bool rf64 = NeedsRF64(dataBytes);
+    const uint64_t riffSize = headerBytes() - 8 + dataBytes + (dataBytes % 2);
+
+    putTag(rf64 ? "RF64" : "RIFF");
+    putInt(rf64 ? sRiffLimit : riffSize, 4);
+    putTag("WAVE");
+
+    //ds64 holds the real sizes for RF64, a plain wav keeps the same space as JUNK so it can become one
+    putTag(rf64 ? "ds64" : "JUNK");
+    putInt(28, 4);
+    if (rf64) {
+        putInt(riffSize, 8);
+        putInt(dataBytes, 8);
+        putInt(numFrames, 8);
+        putInt(0, 4); //no table
+    } else {
+        header.insert(header.end(), 28, 0);
+    }
+
+    putTag("fmt ");
+    putInt(mExtensible ? 40 : 16, 4);
+    putInt(mExtensible ? 0xFFFE : mHeader.audioFormat, 2);
+    putInt(mHeader.numChannels, 2);
+    putInt(mHeader.sampleRate, 4);
+    putInt(mHeader.byteRate, 4);
+    putInt(mHeader.blockAlign, 2);
+    putInt(mHeader.bitsPerSample, 2);
+    if (mExtensible) {
+        putInt(22, 2);
+        putInt(mHeader.bitsPerSample, 2); //valid bits
+        putInt(mChannelMask, 4);
+        //KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT, only the first two bytes differ
+        const unsigned char guid[16] = {0,0, 0x00,0x00, 0x00,0x00, 0x10,0x00, 0x80,0x00, 0x00,0xAA,0x00,0x38,0x9B,0x71};
+        putInt(mHeader.audioFormat, 2);
+        header.insert(header.end(), guid+2, guid+16);
+    }
+
+    if (!mIXML.empty()) {
+        putTag("iXML");
+        putInt(mIXML.size(), 4);
+        header.insert(header.end(), mIXML.begin(), mIXML.end());
+    }
+
+    putTag("data");
+    putInt(rf64 ? sRiffLimit : dataBytes, 4);
+
+    return header;
 }
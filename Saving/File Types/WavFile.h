@@ -7,35 +7,41 @@
 #include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 
+#include "AlignedFileWriter.h"
 #include "../DBConnection.h"
 #include "../../Audio/audioBuffers.h"
 
-struct wavHeader {
-    char chunkID[4] = {'R', 'I', 'F', 'F'};
-    uint32_t chunkSize = 36;
-    char format[4] = {'W', 'A', 'V', 'E'};
-    char subchunk1ID[4] = {'f', 'm', 't', ' '};
-    uint32_t subchunk1Size = 16; // PCM format
-    uint16_t audioFormat = 1;   // PCM
+//the fmt chunk, everything else in the header is worked out from the sizes
+struct wavFormat {
+    uint16_t audioFormat = 1;   // PCM, 3 for float
     uint16_t numChannels = 1;   // Mono
     uint32_t sampleRate = 44100;
     uint32_t byteRate = 176400; // (Sample Rate * BitsPerSample * Channels) / 8
     uint16_t blockAlign = 4; // Channels * BitsPerSample/8
-    uint16_t bitsPerSample = 32; //SAMPLE_SIZE(sampletype)
-    char subchunk2ID[4] = {'d', 'a', 't', 'a'};
-    uint32_t subchunk2Size;
+    uint16_t bitsPerSample = 32;
 };
 
 using namespace std;
 
+//Streams a wav file out front to back. The header is written with the projected size up front and filled in with
+//the real one on close. Past 4GB it becomes RF64, the space for the ds64 chunk is always held by a JUNK chunk
+//so the switch never moves the audio
 class WavFile
 {
-    wavHeader mHeader;
+    wavFormat mHeader;
+
+    //more than 2 channels has to use WAVE_FORMAT_EXTENSIBLE, the mask says which speaker each channel is
+    bool mExtensible = false;
+    uint32_t mChannelMask = 0;
+    //iXML chunk naming the channels, already padded to an even length
+    std::string mIXML;
 
     SampleFormat mFormat;
 
-    ofstream mWavFile;
+    AlignedFileWriter mWavFile;
     bool mConnected = false; //is it connected to a wavFile object
 
     size_t mNumSamples;
@@ -49,25 +55,48 @@ public:
         mHeader.numChannels = numChannels;
         mHeader.audioFormat = (sampleFormat == floatSample ) ? 3:1;
         mHeader.sampleRate = sampleRate;
-        mHeader.bitsPerSample = SAMPLE_SIZE(sampleFormat)*8;
+        mHeader.bitsPerSample = BytesPerSample(sampleFormat)*8;
         mHeader.byteRate = (sampleRate * mHeader.bitsPerSample * numChannels)/8;
         mHeader.blockAlign = numChannels * mHeader.bitsPerSample / 8;
-        mHeader.subchunk2Size = numSamples*mHeader.blockAlign;
-        mHeader.chunkSize = 36 + mHeader.subchunk2Size; //36 is number of bytes in header - 8
 
         mFormat = sampleFormat;
         mNumSamples = numSamples;
         mWrittenSamples = 0;
+
+        mExtensible = numChannels > 2;
     }
 
-    void openWavFile(FilePath wavFilePath);
-    void closeWavFile();
+    //both have to be set before the file is opened, the header is written straight away
+    void setChannelMask(uint32_t mask) {mChannelMask = mask; mExtensible = true;}
+    void setChannelNames(const std::vector<std::string>& names);
+
+    //direct skips the page cache, see AlignedFileWriter. false if the file couldnt be opened, nothing else can be
+    //done with it then (a header that failed to write still needs closing)
+    bool openWavFile(FilePath wavFilePath, bool direct = false);
+    //fills in the real sizes, switching to RF64 if it went past what RIFF can hold. false if the last of the
+    //audio or the header didnt make it to disk, the header is left alone when the audio didnt
+    bool closeWavFile();
+
+    //int24 is held in 4 bytes in memory but only takes 3 in the file
+    static size_t BytesPerSample(SampleFormat format) {return format == int24Sample ? 3 : SAMPLE_SIZE(format);}
+
+    //false once the disk write fails, nothing more gets written after that
+    bool writeSamples(constSamplePtr src, size_t numSamples);
 
-    void writeSamples(constSamplePtr src, size_t numSamples);
+    bool isOpen() const {return mConnected;}
+    bool isRF64() const {return NeedsRF64(uint64_t(mWrittenSamples)*mHeader.blockAlign);}
 
+    //STATIC MEMBERS
+    //biggest size a RIFF chunk can say it is
+    static constexpr uint64_t sRiffLimit = 0xFFFFFFFF;
 
 private:
+    std::vector<char> buildHeader(uint64_t dataBytes, uint64_t numFrames) const;
+    //everything before the audio, the same size whatever the data size is
+    uint64_t headerBytes() const;
+    bool NeedsRF64(uint64_t dataBytes) const;
     void writeHeader();
+    bool finalizeHeader();
 };
 
 
@@ -0,0 +1,311 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "WavImporter.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../../Audio/SampleKernels.h"
+#include "../../Audio/IO/AudioIO.h"
+#include "../../Threading/ThreadPool.h"
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+size_t WavImporter::sChunkFrames = 65536;
+
+namespace {
+    uint64_t readInt(const unsigned char* src, int bytes) {
+        //wav is little endian whatever we're running on
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= uint64_t(src[i]) << (8*i);
+        }
+        return value;
+    }
+
+    //frames deinterleaved per task, small enough to stay in cache
+    constexpr size_t kSliceFrames = 4096;
+}
+
+WavImporter::~WavImporter() {
+    close();
+}
+
+bool WavImporter::open(const FilePath &path) {
+    close();
+
+    if (!map(path)) {
+        //FAILED TO OPEN IMPORT FILE
+        std::cerr<<"Failed to open "<<path<<std::endl;
+        return false;
+    }
+
+    if (!parseHeader()) {
+        std::cerr<<path<<" isnt a wav file that can be imported"<<std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void WavImporter::close() {
+    unmap();
+    mFormatTag = mChannels = mBlockAlign = mBitsPerSample = 0;
+    mSampleRate = 0;
+    mDataOffset = mDataBytes = 0;
+    mRF64 = false;
+}
+
+bool WavImporter::parseHeader() {
+    if (mFileSize < 12 || memcmp(mData + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    if (memcmp(mData, "RF64", 4) == 0 || memcmp(mData, "BW64", 4) == 0) {
+        mRF64 = true;
+    } else if (memcmp(mData, "RIFF", 4) != 0) {
+        return false;
+    }
+
+    uint64_t ds64DataBytes = 0;
+    bool haveFormat = false;
+    bool haveData = false;
+
+    //walk the chunks, anything we dont know gets skipped
+    for (uint64_t pos = 12; pos + 8 <= mFileSize && !haveData;) {
+        const unsigned char* chunk = mData + pos;
+        uint64_t size = readInt(chunk + 4, 4);
+        const uint64_t body = pos + 8;
+
+        if (memcmp(chunk, "ds64", 4) == 0 && size >= 24 && body + 24 <= mFileSize) {
+            ds64DataBytes = readInt(mData + body + 8, 8);
+        } else if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && body + size <= mFileSize) {
+            const unsigned char* fmt = mData + body;
+            mFormatTag = readInt(fmt, 2);
+            mChannels = readInt(fmt + 2, 2);
+            mSampleRate = readInt(fmt + 4, 4);
+            mBlockAlign = readInt(fmt + 12, 2);
+            mBitsPerSample = readInt(fmt + 14, 2);
+
+            //extensible keeps the real format in the first two bytes of the sub format guid
+            if (mFormatTag == 0xFFFE && size >= 40) {
+                mFormatTag = readInt(fmt + 24, 2);
+            }
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (mRF64 && size == 0xFFFFFFFF) {
+                size = ds64DataBytes;
+            }
+            mDataOffset = body;
+            //recorders that died mid file leave the size too big (or 0), only take whats actually there
+            mDataBytes = (size == 0 || body + size > mFileSize) ? mFileSize - body : size;
+            haveData = true;
+        }
+
+        //chunks are padded to even sizes
+        pos = body + size + (size % 2);
+    }
+
+    if (!haveFormat || !haveData || mChannels == 0 || mBlockAlign != mChannels*mBitsPerSample/8) {
+        return false;
+    }
+
+    const bool pcm = mFormatTag == 1 && (mBitsPerSample == 16 || mBitsPerSample == 24 || mBitsPerSample == 32);
+    const bool ieeeFloat = mFormatTag == 3 && mBitsPerSample == 32;
+    return pcm || ieeeFloat;
+}
+
+void WavImporter::deinterleave(uint64_t start, size_t len, float *const *planar) const {
+    const unsigned char* src = mData + mDataOffset + start*mBlockAlign;
+
+    //the mapping only guarantees byte alignment, the kernels use unaligned loads so thats fine
+    if (mFormatTag == 3) {
+        DeinterleaveFloats(reinterpret_cast<const float*>(src), mChannels, len, planar);
+    } else if (mBitsPerSample == 16) {
+        DeinterleaveInt16(reinterpret_cast<const short*>(src), mChannels, len, planar);
+    } else if (mBitsPerSample == 24) {
+        DeinterleaveInt24(src, mChannels, len, planar);
+    } else {
+        //32 bit int, rare enough it doesnt get a kernel
+        for (size_t j = 0; j < len; ++j) {
+            for (size_t c = 0; c < mChannels; ++c) {
+                planar[c][j] = (int32_t)readInt(src, 4)/2147483648.0f;
+                src += 4;
+            }
+        }
+    }
+}
+
+bool WavImporter::importInto(const Tracks &tracks, std::atomic<size_t> *progress) {
+    if (!mData || tracks.size() < mChannels) {
+        //NEED A TRACK FOR EVERY CHANNEL
+        wxASSERT(false);
+        return false;
+    }
+
+    auto& pool = ThreadPool::Get();
+    auto db = AudioIOBase::sAudioDB;
+
+    const uint64_t totalFrames = frames();
+
+    //** MEMORY ALLOCATIONS **
+    std::vector<std::vector<float>> buffers(mChannels, std::vector<float>(sChunkFrames));
+    std::vector<float*> planar(mChannels);
+    //** END OF MEMORY ALLOCATIONS **
+
+    //anything that doesnt make it into the db from here on fails the import
+    const size_t writeFailures = db ? db->getWriteFailures() : 0;
+    bool failed = false;
+
+    //one transaction per sBatchBytes instead of one per block
+    if (db) {
+        db->beginBatch();
+    }
+
+    for (uint64_t pos = 0; pos < totalFrames && !failed;) {
+        const size_t len = std::min<uint64_t>(sChunkFrames, totalFrames - pos);
+
+#if !defined _WIN32
+        //get the os reading the next chunk in while this one is worked on
+        if (pos + len < totalFrames) {
+            const uint64_t next = mDataOffset + (pos + len)*mBlockAlign;
+            const uint64_t page = next/4096*4096;
+            madvise((void*)(mData + page), std::min<uint64_t>(mFileSize - page, uint64_t(len)*mBlockAlign + 4096), MADV_WILLNEED);
+        }
+#endif
+
+        //deinterleaving split up by frames, everyone walks the file front to back instead of striding through it
+        const size_t numSlices = (len + kSliceFrames - 1)/kSliceFrames;
+        pool.parallelFor(numSlices, [&](size_t slice) {
+            const size_t offset = slice*kSliceFrames;
+            std::vector<float*> dst(mChannels);
+            for (size_t c = 0; c < mChannels; ++c) {
+                dst[c] = buffers[c].data() + offset;
+            }
+            deinterleave(pos + offset, std::min(kSliceFrames, len - offset), dst.data());
+        });
+
+        //then the channels go into their sequences at the same time
+        pool.parallelFor(mChannels, [&](size_t c) {
+            tracks[c]->append(0, (constSamplePtr) buffers[c].data(), floatSample, len, 1, floatSample);
+            if (db) {
+                db->checkBatch();
+            }
+        });
+
+        pos += len;
+        if (progress) {
+            *progress += len;
+        }
+
+        failed = db && db->getWriteFailures() != writeFailures;
+    }
+
+    if (!failed) {
+        pool.parallelFor(mChannels, [&](size_t c) {
+            tracks[c]->Flush();
+        });
+    }
+
+    if (db && (!db->endBatch() || db->getWriteFailures() != writeFailures)) {
+        failed = true;
+    }
+
+    if (failed) {
+        //FAILED TO WRITE IMPORTED AUDIO
+        std::cerr<<"Failed to save the imported audio"<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WavImporter::map(const FilePath &path) {
+#if defined _WIN32
+    HANDLE file = CreateFileW(path.wc_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    mFile = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        unmap();
+        return false;
+    }
+    mFileSize = size.QuadPart;
+
+    mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mMapping) {
+        unmap();
+        return false;
+    }
+
+    mData = static_cast<const unsigned char*>(MapViewOfFile((HANDLE)mMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    mFile = ::open(path.ToUTF8(), O_RDONLY);
+    if (mFile < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(mFile, &info) != 0 || info.st_size == 0) {
+        unmap();
+        return false;
+    }
+    mFileSize = info.st_size;
+
+    void* data = mmap(nullptr, mFileSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (data == MAP_FAILED) {
+        unmap();
+        return false;
+    }
+    madvise(data, mFileSize, MADV_SEQUENTIAL);
+    mData = static_cast<const unsigned char*>(data);
+#endif
+
+    if (!mData) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+void WavImporter::unmap() {
+#if defined _WIN32
+    if (mData) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping) {
+        CloseHandle((HANDLE)mMapping);
+    }
+    if (mFile) {
+        CloseHandle((HANDLE)mFile);
+    }
+    mMapping = nullptr;
+    mFile = nullptr;
+#else
+    if (mData) {
+        munmap((void*)mData, mFileSize);
+    }
+    if (mFile >= 0) {
+        ::close(mFile);
+    }
+    mFile = -1;
+#endif
+    mData = nullptr;
+    mFileSize = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef WAVIMPORTER_H
+#define WAVIMPORTER_H
+#include <atomic>
+#include <cstdint>
+
+#include "../DBConnection.h"
+#include "../../Playback/Track.h"
+
+//Reads wav and RF64 files (the ones we export and most recorders write) into tracks straight out of a
+//memory map. 16, 24 and 32 bit PCM and 32 bit float, plain or WAVE_FORMAT_EXTENSIBLE
+class WavImporter {
+#if defined _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#else
+    int mFile = -1;
+#endif
+    const unsigned char* mData = nullptr;
+    uint64_t mFileSize = 0;
+
+    //fmt chunk
+    uint16_t mFormatTag = 0;
+    uint16_t mChannels = 0;
+    uint32_t mSampleRate = 0;
+    uint16_t mBlockAlign = 0;
+    uint16_t mBitsPerSample = 0;
+
+    uint64_t mDataOffset = 0;
+    uint64_t mDataBytes = 0;
+    bool mRF64 = false;
+
+public:
+    WavImporter() = default;
+    ~WavImporter();
+
+    WavImporter(const WavImporter&) = delete;
+    WavImporter& operator=(const WavImporter&) = delete;
+
+    //maps the file and reads the header, false if its not something we can import
+    bool open(const FilePath& path);
+    void close();
+
+    size_t channels() const {return mChannels;}
+    double rate() const {return mSampleRate;}
+    uint64_t frames() const {return mBlockAlign ? mDataBytes/mBlockAlign : 0;}
+    bool isRF64() const {return mRF64;}
+
+    //channel n of the file gets appended onto tracks[n], they should be mono and empty.
+    //progress gets the frames done added to it as it goes
+    bool importInto(const Tracks& tracks, std::atomic<size_t>* progress = nullptr);
+
+    //STATIC MEMBERS
+    //frames deinterleaved and appended per step
+    static size_t sChunkFrames;
+
+private:
+    bool map(const FilePath& path);
+    void unmap();
+    bool parseHeader();
+    //planar gets len frames from frame start on, one buffer per channel
+    void deinterleave(uint64_t start, size_t len, float* const* planar) const;
+};
+
+
+
+#endif //WAVIMPORTER_H
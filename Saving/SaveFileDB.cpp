@@ -60,6 +60,9 @@ int SaveFileDB::open(FilePath save, bool newSave) {
         std::cerr<<sqlite3_errmsg(mDB)<<std::endl;
     }
 
+    if (!newSave) {
+        upgradeSaveDB();
+    }
 
     return err;
 }
@@ -67,6 +70,14 @@ int SaveFileDB::open(FilePath save, bool newSave) {
 void SaveFileDB::close() {
     assert(mDB != nullptr);
 
+    {
+        std::lock_guard<std::mutex> guard(mReaderMutex);
+        for (auto& reader : mReaders) {
+            sqlite3_close(reader.second);
+        }
+        mReaders.clear();
+    }
+
     sqlite3_close(mDB);
     mDB = nullptr;
 }
@@ -85,13 +96,25 @@ void SaveFileDB::initSaveDB() {
 
     sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
 
+    //summaries the SummaryWorker filled in after the block was saved
+    sql = "CREATE TABLE IF NOT EXISTS sampleSummaries ( "
+          "blockID INTEGER PRIMARY KEY, "
+          "summin REAL, "
+          "summax REAL, "
+          "sumrms REAL, "
+          "summary256 BLOB,"
+          "summary64k BLOB);";
+
+    sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
+
     sql = "CREATE TABLE IF NOT EXISTS tracks ("
           "trackNum INTEGER PRIMARY KEY,"
           "trackType INTEGER,"
           "firstChannelIn INTEGER,"
           "firstChannelOut INTEGER,"
           "sampleRate REAL,"
-          "blocks BLOB);";
+          "blocks BLOB,"
+          "blockOffsets BLOB);";
 
     sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
 
@@ -100,7 +123,8 @@ void SaveFileDB::initSaveDB() {
           "hostAPI INTEGER,"
           "inDev INTEGER,"
           "outDEV INTEGER,"
-          "sRate REAL);";
+          "sRate REAL,"
+          "silenceDb REAL);";
 
     sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
 
@@ -115,6 +139,29 @@ void SaveFileDB::initSaveDB() {
     sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
 }
 
+void SaveFileDB::upgradeSaveDB() {
+    //Saves made before block offsets were stored dont have the column, those tracks just get loaded the slow way
+    const char* sql = "ALTER TABLE tracks ADD COLUMN blockOffsets BLOB;";
+
+    sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
+
+    //as are saves from before deferred summaries got their own table
+    sql = "CREATE TABLE IF NOT EXISTS sampleSummaries ( "
+          "blockID INTEGER PRIMARY KEY, "
+          "summin REAL, "
+          "summax REAL, "
+          "sumrms REAL, "
+          "summary256 BLOB,"
+          "summary64k BLOB);";
+
+    sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
+
+    //and from before silence gating was a show setting, NULL leaves it off
+    sql = "ALTER TABLE settings ADD COLUMN silenceDb REAL;";
+
+    sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr);
+}
+
 sqlite3_stmt *SaveFileDB::Prepare(const char *sql) {
     sqlite3_stmt* stmt;
     auto err = sqlite3_prepare_v3(DB(), sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0);
@@ -128,4 +175,43 @@ sqlite3_stmt *SaveFileDB::Prepare(const char *sql) {
     return stmt;
 }
 
+sqlite3_stmt *SaveFileDB::PrepareRead(const char *sql) {
+    auto db = ReadDB();
+
+    sqlite3_stmt* stmt;
+    auto err = sqlite3_prepare_v3(db, sql, -1, 0, &stmt, 0);
+
+    if (err != SQLITE_OK) {
+        //FAILED TO PREPARE STATMENT
+        std::cout<< "Err Code: "<< sqlite3_errmsg(db) << std::endl;
+        wxASSERT(false);
+    }
+
+    return stmt;
+}
+
+sqlite3 *SaveFileDB::ReadDB() {
+    std::lock_guard<std::mutex> guard(mReaderMutex);
+
+    auto iter = mReaders.find(std::this_thread::get_id());
+    if (iter != mReaders.end()) {
+        return iter->second;
+    }
+
+    sqlite3* db = nullptr;
+    int err = sqlite3_open_v2(mSavePath.ToUTF8(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+
+    if (err != SQLITE_OK) {
+        //fall back to the main connection
+        std::cerr<<"Failed to open read connection, err code: "<<sqlite3_errstr(err)<<std::endl;
+        sqlite3_close(db);
+        return mDB;
+    }
+
+    sqlite3_busy_timeout(db, 5000);
+    mReaders.insert({std::this_thread::get_id(), db});
+
+    return db;
+}
+
 
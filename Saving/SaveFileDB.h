@@ -8,6 +8,10 @@
 
 #ifndef SAVEFILEDB_H
 #define SAVEFILEDB_H
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "DBConnection.h"
 
 
@@ -17,19 +21,27 @@ class SaveFileDB{
 
     sqlite3* mDB;
 
+    //read only connections for loading on worker threads
+    std::mutex mReaderMutex;
+    std::map<std::thread::id, sqlite3*> mReaders;
+
 public:
     bool newSave(FilePath save);
     int open(FilePath save, bool newSave = false);
     void close();
 
     sqlite3_stmt* Prepare(const char* sql);
+    //same as Prepare but on this threads read only connection
+    sqlite3_stmt* PrepareRead(const char* sql);
 
     FilePath GetSavePath() {return mSavePath;};
 
     sqlite3* DB(){return mDB;}
+    sqlite3* ReadDB();
 
 private:
     void initSaveDB();
+    void upgradeSaveDB();
 };
 
 using SaveFile = std::shared_ptr<SaveFileDB>;
@@ -0,0 +1,72 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+//Hands items from one thread to the next, push waits while the queue is full so a fast
+//producer cant run away from a slow consumer. Once closed pops drain whatever is left then return nothing
+template<typename T>
+class BoundedQueue {
+    std::deque<T> mItems;
+    size_t mCapacity;
+    bool mClosed = false;
+
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+
+public:
+    explicit BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+    //false if the queue was closed before there was room
+    bool push(T item) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotFull.wait(lock, [this] {return mClosed || mItems.size() < mCapacity;});
+            if (mClosed) {
+                return false;
+            }
+            mItems.push_back(std::move(item));
+        }
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::optional<T> item;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotEmpty.wait(lock, [this] {return mClosed || !mItems.empty();});
+            if (mItems.empty()) {
+                return std::nullopt;
+            }
+            item = std::move(mItems.front());
+            mItems.pop_front();
+        }
+        mNotFull.notify_one();
+        return item;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+        }
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+};
+
+
+
+#endif //BOUNDEDQUEUE_H
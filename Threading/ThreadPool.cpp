@@ -0,0 +1,60 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    //hardware_concurrency can return 0 if it cant tell
+    numThreads = std::max<size_t>(numThreads, 1);
+
+    mWorkers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        mWorkers.emplace_back([this] {workerThread();});
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mTaskMutex);
+        mStop = true;
+    }
+    mTaskCV.notify_all();
+
+    for (auto& worker : mWorkers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool &ThreadPool::Get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerThread() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mTaskMutex);
+            mTaskCV.wait(lock, [this] {return mStop || !mTasks.empty();});
+
+            //finish whatever is queued before exiting
+            if (mStop && mTasks.empty()) {
+                return;
+            }
+
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+
+        task();
+    }
+}
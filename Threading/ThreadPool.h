@@ -0,0 +1,86 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+
+    std::mutex mTaskMutex;
+    std::condition_variable mTaskCV;
+
+    bool mStop = false;
+
+public:
+    explicit ThreadPool(size_t numThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Shared pool for the app, sized to the number of cores
+    static ThreadPool& Get();
+
+    size_t size() const {return mWorkers.size();}
+
+    template<typename F>
+    auto submit(F&& func) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+
+        //packaged_task isnt copyable so it has to live behind a shared_ptr to fit in std::function
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mTaskMutex);
+            mTasks.emplace_back([task] {(*task)();});
+        }
+        mTaskCV.notify_one();
+
+        return future;
+    }
+
+    //job(i) for every i below count spread over the pool, returns once theyre all done.
+    //dont call it from a pool thread, it waits on the other workers
+    template<typename F>
+    void parallelFor(size_t count, F&& job) {
+        const size_t numWorkers = std::min(count, std::max<size_t>(size(), 1));
+
+        std::atomic<size_t> next {0};
+        std::vector<std::future<void>> workers;
+        workers.reserve(numWorkers);
+        for (size_t w = 0; w < numWorkers; ++w) {
+            workers.push_back(submit([&] {
+                for (size_t i; (i = next++) < count;) {
+                    job(i);
+                }
+            }));
+        }
+        for (auto& worker : workers) {
+            worker.get();
+        }
+    }
+
+private:
+    void workerThread();
+};
+
+
+
+#endif //THREADPOOL_H
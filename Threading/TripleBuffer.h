@@ -0,0 +1,56 @@
+/*
+ * This file is part of VSoundCheckr
+ * Copyright (C) 2025 Kieran Cline
+ *
+ * Licensed under the GNU General Public License v3.0
+ * See LICENSE file for details.
+ */
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+#include <atomic>
+
+//Hands the newest value from one writer to one reader without either of them ever waiting. The writer fills
+//back() and publishes it, the reader picks up whatever was published last with update() and reads front().
+//Values that get published before the reader comes round are just replaced, so its only for state not events
+template<typename T>
+class TripleBuffer {
+    T mSlots[3];
+
+    //slot in the middle, with sFresh set when the writer put it there and the reader hasnt taken it yet
+    std::atomic<int> mMiddle {1};
+    //writer only
+    int mBack = 0;
+    //reader only
+    int mFront = 2;
+
+    static constexpr int sFresh = 4;
+    static constexpr int sIndexMask = 3;
+
+public:
+    T& back() {return mSlots[mBack];}
+    //the old middle comes back as the new back, it holds whatever was in it before so write all of it
+    void publish() {mBack = mMiddle.exchange(mBack | sFresh, std::memory_order_acq_rel) & sIndexMask;}
+
+    //false if nothing new was published since the last call, front() stays as it was
+    bool update() {
+        if (!(mMiddle.load(std::memory_order_relaxed) & sFresh)) {
+            return false;
+        }
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & sIndexMask;
+        return true;
+    }
+    const T& front() const {return mSlots[mFront];}
+
+    //only while neither side is using it, for sizing the slots up front
+    template<typename F>
+    void forEach(F&& f) {
+        for (auto& slot : mSlots) {
+            f(slot);
+        }
+    }
+};
+
+
+
+#endif //TRIPLEBUFFER_H
@@ -8,6 +8,7 @@
 
 #include "PlaybackHandler.h"
 
+#include <cmath>
 #include <iostream>
 #include <wx/filedlg.h>
 #include <wx/translation.h>
@@ -16,6 +17,10 @@
 #include "AppBase.h"
 #include "../Midi/MidiIO.h"
 #include "../Saving/Exporter.h"
+#include "../Playback/AudioGraph/LoudnessAnalyzer.h"
+#include "../Playback/AudioGraph/SongFinder.h"
+#include "../Saving/File Types/WavImporter.h"
+#include "../Threading/ThreadPool.h"
 
 using namespace std;
 
@@ -77,6 +82,20 @@ string makeTime(size_t seconds) {
     return to_string(hours) + "H " + to_string(minutes) + "M " + to_string(secondsConv)+"s";
 }
 
+//peak/rms in dB for every channel, 8 to a line, ! after anything that clipped since the last refresh
+string makeLevels(const string& label, const vector<LevelMeter::Level>& levels, const LevelMeter::Stats& stats) {
+    char cell[32];
+    string out = label + " (peak/rms dB, metering "+to_string((int)stats.avgUs)+"us a callback, max "+to_string((int)stats.maxUs)+"us)\n";
+    for (size_t c = 0; c < levels.size(); ++c) {
+        snprintf(cell, sizeof(cell), "%3d %5.1f/%5.1f%c ", (int)c+1, LevelMeter::toDb(levels[c].peak), LevelMeter::toDb(levels[c].rms), levels[c].clipping ? '!' : ' ');
+        out += cell;
+        if (c % 8 == 7 || c+1 == levels.size()) {
+            out += "\n";
+        }
+    }
+    return out;
+}
+
 
 //Menu Stuff
 //------------------------------------------------------------------------------------
@@ -181,6 +200,7 @@ void PlaybackHandler::PlaybackMenu() {
               "1 View Tracks \n"
               "2 Record \n"
               "3 Playback \n"
+              "4 Loop Section \n"
               "0 Back \n"
               ">>";
         cin>>input;
@@ -194,6 +214,12 @@ void PlaybackHandler::PlaybackMenu() {
                     RecordMenu();
                     string recordingStr = makeTime(mTracks[0]->getLengthS());
                     cout<<"successfully recorded "<<recordingStr<<endl;
+                    for (auto &track : mTracks) {
+                        if (track->getSilentBytes() > 0) {
+                            cout<<"Track #"<<track->getTrackNum()<<": "<<track->getSilentBytes()/(1024*1024)<<"MB of silence not written ("
+                                <<(int)(track->getSilentFraction()*100)<<"% of the track)"<<endl;
+                        }
+                    }
                     waitForKeyPress();
                 }
             }break;
@@ -202,6 +228,22 @@ void PlaybackHandler::PlaybackMenu() {
                     PlayMenu();
                 }
             } break;
+            case 4: {
+                double loopStart, loopEnd;
+                cout<<"Enter the start of the loop in seconds (track length: "<<makeTime(mTracks.empty() ? 0 : mTracks[0]->getLengthS())<<")\n>>";
+                cin>>loopStart;
+                cout<<"Enter the end of the loop in seconds\n>>";
+                cin>>loopEnd;
+
+                if (loopEnd > loopStart && loopStart >= 0) {
+                    if (Play(std::make_pair(loopStart, loopEnd))) {
+                        PlayMenu();
+                    }
+                } else {
+                    cout<<"Invalid loop range"<<endl;
+                    waitForKeyPress();
+                }
+            } break;
             case 0: {
                 loop = false;
             } break;
@@ -252,7 +294,16 @@ void PlaybackHandler::RecordUIThread() {
                 ">>";
 
         } else {
+            auto metrics = AudioIO::sAudioDB->getCheckpointMetrics();
+            size_t silentBytes = 0;
+            for (auto &track : mTracks) {
+                silentBytes += track->getSilentBytes();
+            }
             cout<<"Recording (" << makeTime(mAudioIO->getRecordingTime()) << ")\n"
+                "Disk: "<<metrics.writeRate/(1024*1024)<<"MB/s, WAL "<<metrics.walBytes/(1024*1024)<<"MB, "
+                "last checkpoint "<<metrics.lastCheckpointMs<<"ms, "<<metrics.deferred<<"/"<<metrics.checkpoints<<" deferred ("<<metrics.totalStallMs/1000<<"s)\n"
+                "Silence: "<<silentBytes/(1024*1024)<<"MB not written\n"
+                <<makeLevels("Inputs", mAudioIO->getInputLevels(), mAudioIO->getInputMeterStats())<<
                 "1 Pause Recording \n"
                 "2 End Recording \n"
                 "3 Create Snapshot \n"
@@ -309,6 +360,12 @@ void PlaybackHandler::PlayMenu() {
                     }
                 }
             }break;
+            case 4: {
+                mTracks[inputTrackNum()]->toggleSolo();
+            } break;
+            case 5: {
+                mTracks[inputTrackNum()]->toggleMute();
+            } break;
 
             case 10:
             case 15:
@@ -333,13 +390,25 @@ void PlaybackHandler::PlayUIThread() {
                 "1 UnPause Playback \n"
                 "2 Stop Playback \n"
                 "3 Go to Snapshot\n"
+                "4 Solo/UnSolo Track\n"
+                "5 Mute/UnMute Track\n"
                 "(-/+) (10,15,30) move playback by inputted distance\n"
                 ">>";
 
         } else {
+            auto prefetch = mAudioIO->getPrefetchStats();
+            auto silence = mAudioIO->getSilenceStats();
+            auto buffering = mAudioIO->getBufferStats();
             cout<<"Playing Back Audio ( "<< makeTime(mAudioIO->getCurrentPlaybackTime())<<" \\ " << makeTime(mTracks[0]->getLengthS()) << ")\n"
+                "Prefetch: "<<(int)(prefetch.hitRate*100)<<"% hits, "<<prefetch.prefetched<<" blocks, lead "<<prefetch.avgLead<<"s (min "<<prefetch.minLead<<"s)\n"
+                "Silenced: "<<silence.readsSkipped<<" block reads skipped ("<<silence.bytesSkipped/(1024*1024)<<"MB not read from disk)\n"
+                "Buffering: "<<(int)buffering.depthMs<<"ms rings, "<<(int)buffering.batchMs<<"ms batches, slowest read "<<buffering.peakPassMs<<"ms, "
+                <<buffering.underruns<<" underruns\n"
+                <<makeLevels("Outputs", mAudioIO->getOutputLevels(), mAudioIO->getOutputMeterStats())<<
                 "1 Pause Playback \n"
                 "2 Stop Playback \n"
+                "4 Solo/UnSolo Track\n"
+                "5 Mute/UnMute Track\n"
                 "(-/+) (10,15,30) move playback by inputted distance \n"
                 ">>";
         }
@@ -356,8 +425,11 @@ void PlaybackHandler::PlayMidiUI() {
             cout<<"Playback Paused ( " << makeTime(mAudioIO->getCurrentPlaybackTime())<<" \\ " << makeTime(mTracks[0]->getLengthS()) << ")\n";
             cout<<"Snapshot: "<<mSnapshotHandler->getCurrentSnapshot()<<endl;
         } else {
+            auto recall = mAudioIO->getRecallStats();
             cout<<"Playing Back Audio ( "<< makeTime(mAudioIO->getCurrentPlaybackTime())<<" \\ " << makeTime(mTracks[0]->getLengthS()) << ")\n";
             cout<<"Snapshot: "<<mSnapshotHandler->getCurrentSnapshot()<<endl;
+            cout<<"Recall: "<<recall.warm<<" snapshots warm ("<<recall.bytes/(1024*1024)<<"MB), "
+                <<recall.warmRecalls<<"/"<<recall.recalls<<" instant, last "<<recall.lastRecallMs<<"ms, avg "<<recall.avgRecallMs<<"ms, max "<<recall.maxRecallMs<<"ms"<<endl;
         }
 
         using namespace chrono;
@@ -379,6 +451,9 @@ void PlaybackHandler::TracksMenu() {
               "4 Change Input Channels on a Track \n"
               "5 Change Output Channels on a Track \n"
               "6 Change Track Type \n"
+              "7 Change Track Mix (gain/pan) \n"
+              "8 Import Wav File \n"
+              "9 Analyze Track Loudness \n"
               "0 Back \n"
               ">>";
         cin>>input;
@@ -447,6 +522,29 @@ void PlaybackHandler::TracksMenu() {
                     waitForKeyPress();
                 }
             } break;
+            case 7: {
+                if (mTracks.size() > 0) {
+                    auto& track = mTracks[inputTrackNum()];
+                    double gainDb, pan;
+                    cout<<"Enter the gain in dB: (Current: "<<20*log10(std::max(track->getGain(), 1e-6f))<<") \n>>";
+                    cin>>gainDb;
+                    cout<<"Enter the pan from -1 (left) to 1 (right): (Current: "<<track->getPan()<<") \n>>";
+                    cin>>pan;
+                    track->setGain((float)pow(10.0, gainDb/20));
+                    track->setPan((float)pan);
+                } else {
+                    cout<<"No Tracks have been created, please create a track first"<<endl;
+                    waitForKeyPress();
+                }
+            } break;
+            case 8: {
+                importWav();
+                waitForKeyPress();
+            } break;
+            case 9: {
+                analyzeLoudness();
+                waitForKeyPress();
+            } break;
             case 0: {
                 loop = false;
             } break;
@@ -468,6 +566,7 @@ void PlaybackHandler::AudioSettingsMenu() {
               "2 Change Input Device \n"
               "3 Change Output Device \n"
               "4 Change Sample Rate \n"
+              "5 Silence Gating \n"
               "0 Back \n"
               ">>";
         cin>>input;
@@ -496,6 +595,10 @@ void PlaybackHandler::AudioSettingsMenu() {
                 changeSRate();
                 waitForKeyPress();
             } break;
+            case 5: {
+                mUnSaved = true;
+                changeSilenceGate();
+            } break;
             case 0: {
                 loop = false;
             } break;
@@ -610,6 +713,7 @@ void PlaybackHandler::SnapshotMenu() {
         cout<<"Snapshot Menu: \n"
               "1 View Snapshots \n"
               "2 change snapshots name \n"
+              "3 Find Songs and place snapshots \n"
               "0 Back \n"
               ">>";
         cin>>input;
@@ -623,6 +727,10 @@ void PlaybackHandler::SnapshotMenu() {
                 changeSnapshotsName();
                 waitForKeyPress();
             } break;
+            case 3: {
+                findSongs();
+                waitForKeyPress();
+            } break;
             case 0: {
                 loop = false;
             } break;
@@ -678,6 +786,20 @@ void PlaybackHandler::createAudioTempDB() {
         std::cout<<errmsg<<std::endl;
         throw;
     }
+
+    sql = "CREATE TABLE IF NOT EXISTS sampleSummaries ( "
+          "blockID INTEGER PRIMARY KEY, "
+          "summin REAL, "
+          "summax REAL, "
+          "sumrms REAL, "
+          "summary256 BLOB,"
+          "summary64k BLOB);";
+
+    rc = sqlite3_exec(AudioIO::sAudioDB->DB(), sql, nullptr, nullptr, &errmsg);
+    if (rc) {
+        std::cout<<errmsg<<std::endl;
+        throw;
+    }
 }
 
 void PlaybackHandler::newSave() {
@@ -730,12 +852,13 @@ void PlaybackHandler::save() {
         assert(false);
     }
 
-    auto stmt = mSaveConn->Prepare("INSERT INTO settings (hostAPI, inDev, outDev, sRate)"
-                                       "                           VALUES(?1, ?2, ?3, ?4);");
+    auto stmt = mSaveConn->Prepare("INSERT INTO settings (hostAPI, inDev, outDev, sRate, silenceDb)"
+                                       "                           VALUES(?1, ?2, ?3, ?4, ?5);");
     if (sqlite3_bind_int(stmt, 1, mHostApi) ||
         sqlite3_bind_int(stmt, 2, mAudioInDev) ||
         sqlite3_bind_int(stmt, 3, mAudioOutDev) ||
-        sqlite3_bind_double(stmt, 4, mRate)) {
+        sqlite3_bind_double(stmt, 4, mRate) ||
+        bindSilenceGate(stmt, 5)) {
         wxASSERT(false);
         }
 
@@ -778,12 +901,13 @@ void PlaybackHandler::newShow() {
         mSnapshotHandler->mSaveConn = mSaveConn;
         mSnapshotHandler->newShow();
 
-        auto stmt = mSaveConn->Prepare("INSERT INTO settings (hostAPI, inDev, outDev, sRate)"
-                                      "                           VALUES(?1, ?2, ?3, ?4);");
+        auto stmt = mSaveConn->Prepare("INSERT INTO settings (hostAPI, inDev, outDev, sRate, silenceDb)"
+                                      "                           VALUES(?1, ?2, ?3, ?4, ?5);");
         if (sqlite3_bind_int(stmt, 1, mHostApi) ||
             sqlite3_bind_int(stmt, 2, mAudioInDev) ||
             sqlite3_bind_int(stmt, 3, mAudioOutDev) ||
-            sqlite3_bind_double(stmt, 4, mRate)) {
+            sqlite3_bind_double(stmt, 4, mRate) ||
+            bindSilenceGate(stmt, 5)) {
             wxASSERT(false);
             }
 
@@ -820,7 +944,7 @@ void PlaybackHandler::load(int) {
     }
     AudioIO::sAudioDB->open(mSaveConn->GetSavePath(), false);
 
-    auto stmt = mSaveConn->Prepare("SELECT hostAPI, inDev, outDev, sRate FROM settings WHERE _ = 1;");
+    auto stmt = mSaveConn->Prepare("SELECT hostAPI, inDev, outDev, sRate, silenceDb FROM settings WHERE _ = 1;");
 
     if (sqlite3_step(stmt) != SQLITE_ROW) {
         cerr<<"Failed to execute stmt"<<endl;
@@ -830,6 +954,8 @@ void PlaybackHandler::load(int) {
     mAudioInDev = sqlite3_column_int(stmt, 1);
     mAudioOutDev = sqlite3_column_int(stmt, 2);
     mRate = sqlite3_column_double(stmt, 3);
+    mSilenceGateDb = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? 0.0f : (float)sqlite3_column_double(stmt, 4);
+    applySilenceGate();
 
     sqlite3_finalize(stmt);
 
@@ -841,12 +967,25 @@ void PlaybackHandler::load(int) {
 
     int numTracks = sqlite3_column_int(stmt, 0);
     sqlite3_finalize(stmt);
+
+    auto loadStart = chrono::steady_clock::now();
+
     mTracks.clear();
     mTracks.resize(numTracks);
+
+    //tracks dont share anything while loading so each one goes to its own worker
+    vector<future<void>> loads;
+    loads.reserve(numTracks);
     for (int i = 0; i < numTracks; ++i) {
         mTracks[i] = make_shared<Track>(mRate, floatSample, i+1);
         mTracks[i]->mSaveConn = mSaveConn;
-        mTracks[i]->load(i+1);
+
+        loads.push_back(ThreadPool::Get().submit([track = mTracks[i], i] {
+            track->load(i+1);
+        }));
+    }
+    for (auto& load : loads) {
+        load.get();
     }
     mSnapshotHandler = make_shared<SnapshotHandler>();
     mSnapshotHandler->mSaveConn = mSaveConn;
@@ -854,7 +993,9 @@ void PlaybackHandler::load(int) {
 
     mUnSaved = false;
 
-    cout<<"loading complete"<<endl;
+    auto loadTime = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - loadStart);
+
+    cout<<"loading complete ("<<numTracks<<" tracks in "<<loadTime.count()<<"ms on "<<ThreadPool::Get().size()<<" threads"<<(Track::isLazyLoad() ? ", lazy" : "")<<")"<<endl;
     waitForKeyPress();
 }
 
@@ -863,8 +1004,11 @@ void PlaybackHandler::copyAudioTempDBToMainSave() const {
     auto tmpDB = AudioIO::sAudioDB->DB();
     auto saveDB = mSaveConn->DB();
 
-    const char* sql = "SELECT sampleformat, summin, summax, sumrms,"
-        "                              samples, length(samples), summary256, length(summary256), summary64k, length(summary64k) FROM sampleBlocks;";
+    //deferred summaries get folded back into their block rows
+    const char* sql = "SELECT b.sampleformat, COALESCE(s.summin, b.summin), COALESCE(s.summax, b.summax), COALESCE(s.sumrms, b.sumrms),"
+        "                              b.samples, length(b.samples), COALESCE(s.summary256, b.summary256), length(COALESCE(s.summary256, b.summary256)),"
+        "                              COALESCE(s.summary64k, b.summary64k), length(COALESCE(s.summary64k, b.summary64k))"
+        "                              FROM sampleBlocks b LEFT JOIN sampleSummaries s ON s.blockID = b.blockID ORDER BY b.blockID;";
     sqlite3_stmt* stmt;
 
 
@@ -954,7 +1098,7 @@ void PlaybackHandler::endRecording() {
     mRecording.store(false, std::memory_order_release);
 }
 
-bool PlaybackHandler::Play() {
+bool PlaybackHandler::Play(std::optional<std::pair<double, double>> loopRange) {
     if (!mSaveFile && !AudioIO::sAudioDB->DB() || mTracks.empty() || mTracks[0]->getLengthS() == 0) {
         cout<<"Nothing to playback :("<<endl;
         waitForKeyPress();
@@ -982,10 +1126,15 @@ bool PlaybackHandler::Play() {
 
     auto snapshot = mSnapshotHandler->getSnapshot(mSnapshotHandler->getCurrentSnapshot());
     options.mStartTime = snapshot.timestamp;
+    options.mLoopRange = loopRange;
 
     bool done =  mAudioIO->startStream(transports, 0, mTracks[0]->getLengthS(),options);
     mPlaying.store(done, std::memory_order_release);
 
+    if (done) {
+        warmSnapshots();
+    }
+
     return done;
 }
 
@@ -1091,6 +1240,7 @@ void PlaybackHandler::snapshotAction(snapshotMidi md) {
         if (s.number != -1) {
             mAudioIO->jumpToTime(s.timestamp);
             mSnapshotHandler->setCurrentSnapshot(s.number);
+            warmSnapshots();
         }
     } else {
         auto s = mSnapshotHandler->getSnapshot(md);
@@ -1112,9 +1262,19 @@ void PlaybackHandler::snapshotAction(int k) {
         auto s = mSnapshotHandler->getSnapshot(k);
         mAudioIO->jumpToTime(s.timestamp);
         mSnapshotHandler->setCurrentSnapshot(s.number);
+        warmSnapshots();
     }
 }
 
+void PlaybackHandler::warmSnapshots() {
+    std::vector<double> times;
+    for (auto& snapshot : mSnapshotHandler->getSnapshots()) {
+        times.push_back(snapshot.timestamp);
+    }
+
+    mAudioIO->setSnapshots(times, mSnapshotHandler->getCurrentSnapshot());
+}
+
 //Snapshot Stuff
 void PlaybackHandler::viewSnapshots() {
     auto snapshots = mSnapshotHandler->getSnapshots();
@@ -1150,6 +1310,74 @@ void PlaybackHandler::changeSnapshotsName() {
     }
 }
 
+void PlaybackHandler::findSongs() {
+    if (mTracks.empty() || mTracks[0]->getLengthS() <= 0) {
+        cout<<"Nothing has been recorded yet"<<endl;
+        return;
+    }
+
+    int numTracks;
+    cout<<"How many tracks should be listened to? (0 for all) \n>>";
+    cin>>numTracks;
+
+    Tracks tracks;
+    if (numTracks <= 0 || numTracks >= mTracks.size()) {
+        tracks = mTracks;
+    } else {
+        for (int i = 0; i < numTracks; ++i) {
+            tracks.push_back(mTracks[inputTrackNum()]);
+        }
+    }
+
+    AudioGraph::SongFinder::Settings settings {-50.0f, 8.0, 0.5};
+    double value;
+    cout<<"Silence level in dBFS (enter 0 for "<<settings.silenceDb<<") \n>>";
+    cin>>value;
+    if (value < 0) {
+        settings.silenceDb = (float)value;
+    }
+    cout<<"Shortest gap between songs in seconds (enter 0 for "<<settings.minSilenceSecs<<") \n>>";
+    cin>>value;
+    if (value > 0) {
+        settings.minSilenceSecs = value;
+    }
+
+    AudioGraph::SongFinder finder(tracks, settings);
+    auto searchStart = chrono::steady_clock::now();
+    auto songs = finder.find();
+    const double secs = chrono::duration<double>(chrono::steady_clock::now() - searchStart).count();
+
+    cout<<"Found "<<songs.size()<<" songs in "<<secs<<"s ("<<finder.samplesRead()<<" samples read)"<<endl;
+
+    //leave out anything that already has a snapshot on it
+    auto snapshots = mSnapshotHandler->getSnapshots();
+    vector<AudioGraph::SongFinder::Song> proposed;
+    for (auto& song : songs) {
+        const bool taken = std::any_of(snapshots.begin(), snapshots.end(), [&](const Snapshot& s) {
+            return std::abs(s.timestamp - song.time) < settings.minSilenceSecs;
+        });
+        if (!taken) {
+            proposed.push_back(song);
+            cout<<proposed.size()<<": "<<makeTime(song.time)<<" ("<<song.time<<"s, after "
+                <<(song.onset - song.silenceStart).as_double()/mRate<<"s of silence)"<<endl;
+        }
+    }
+
+    if (proposed.empty()) {
+        cout<<"No new snapshots to place"<<endl;
+        return;
+    }
+
+    cout<<"Place a snapshot at each of these? ";
+    if (YNConfirm()) {
+        for (size_t i = 0; i < proposed.size(); ++i) {
+            mSnapshotHandler->insertSnapshot(proposed[i].time, "Song " + to_string(i+1));
+        }
+        mUnSaved = true;
+        cout<<"Placed "<<proposed.size()<<" snapshots"<<endl;
+    }
+}
+
 bool PlaybackHandler::goToSnapshot() {
     auto snapshotsSize = mSnapshotHandler->getSnapshots().size();
     if (snapshotsSize > 0) {
@@ -1343,6 +1571,32 @@ void PlaybackHandler::changeSRate() {
 
     waitForKeyPress();
 }
+void PlaybackHandler::changeSilenceGate() {
+    clrscr();
+    cout<<"Inputs that stay under this level get stored as silence instead of being written, anything under it is lost.\n"
+          "Silence gate level in dBFS (Current: ";
+    if (mSilenceGateDb < 0) {
+        cout<<mSilenceGateDb;
+    } else {
+        cout<<"off";
+    }
+    cout<<", enter 0 to turn it off) \n>>";
+
+    double value;
+    if (cin>>value) {
+        mSilenceGateDb = value < 0 ? (float)value : 0.0f;
+        applySilenceGate();
+    }
+}
+
+void PlaybackHandler::applySilenceGate() {
+    Sequence::setSilenceThreshold(mSilenceGateDb < 0 ? powf(10.0f, mSilenceGateDb/20.0f) : -1.0f);
+}
+
+int PlaybackHandler::bindSilenceGate(sqlite3_stmt *stmt, int index) const {
+    return mSilenceGateDb < 0 ? sqlite3_bind_double(stmt, index, mSilenceGateDb) : sqlite3_bind_null(stmt, index);
+}
+
 void PlaybackHandler::getSupportedRates(std::vector<size_t> &rates) {
     std::vector<size_t> possibleRates = {32000, 44100, 48000, 88200, 96000, 176400, 192000};
 
@@ -1422,6 +1676,104 @@ bool PlaybackHandler::newTrack() {
     return true;
 }
 
+void PlaybackHandler::importWav() {
+    wxFileDialog importFileDialog(nullptr, _("Choose a Wav File"), "","", "Wav file (*.wav) | *.wav", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+
+    if (importFileDialog.ShowModal() == wxID_CANCEL) {
+        cout<<"Canceled Import"<<endl;
+        return;
+    }
+
+    WavImporter importer;
+    if (!importer.open(importFileDialog.GetPath())) {
+        return;
+    }
+
+    //NO RESAMPLING ON IMPORT YET
+    if (importer.rate() != mRate) {
+        cout<<"The file is "<<importer.rate()<<"Hz but the show is "<<mRate<<"Hz, change the sample rate first"<<endl;
+        return;
+    }
+
+    Tracks imported;
+    for (size_t i = 0; i < importer.channels(); ++i) {
+        newTrack();
+        imported.push_back(mTracks.back());
+    }
+    mUnSaved = true;
+
+    const auto frames = importer.frames();
+    atomic<size_t> progress {0};
+    atomic<bool> done {false};
+    auto importStart = chrono::steady_clock::now();
+
+    //not on the pool, the importer spreads its own work over it
+    bool succeeded = false;
+    std::thread importThread([&] {
+        succeeded = importer.importInto(imported, &progress);
+        done = true;
+    });
+
+    while (!done) {
+        cout<<"\rImporting: "<<(frames ? progress.load()*100/frames : 100)<<"%   "<<flush;
+        std::this_thread::sleep_for(chrono::milliseconds(500));
+    }
+    importThread.join();
+
+    if (!succeeded) {
+        cout<<"\rImport failed, the "<<importer.channels()<<" imported tracks are missing audio"<<endl;
+        return;
+    }
+
+    const double secs = chrono::duration<double>(chrono::steady_clock::now() - importStart).count();
+    cout<<"\rImported "<<importer.channels()<<" channels ("<<makeTime(frames/mRate)<<") in "<<secs<<"s"
+        <<(importer.isRF64() ? " from RF64" : "")<<endl;
+}
+
+void PlaybackHandler::analyzeLoudness() {
+    if (mTracks.empty()) {
+        cout<<"No Tracks have been created, please create a track first"<<endl;
+        return;
+    }
+
+    size_t total = 0;
+    for (auto& track : mTracks) {
+        total += track->getSampleCount().as_size_t();
+    }
+
+    AudioGraph::LoudnessAnalyzer analyzer(mTracks);
+    vector<AudioGraph::LoudnessAnalyzer::Result> results;
+    atomic<size_t> progress {0};
+    atomic<bool> done {false};
+    auto analyzeStart = chrono::steady_clock::now();
+
+    //not on the pool, the analyzer spreads the tracks over it
+    std::thread analyzeThread([&] {
+        results = analyzer.analyze(&progress);
+        done = true;
+    });
+
+    while (!done) {
+        cout<<"\rAnalyzing: "<<(total ? progress.load()*100/total : 100)<<"%   "<<flush;
+        std::this_thread::sleep_for(chrono::milliseconds(500));
+    }
+    analyzeThread.join();
+
+    const double secs = chrono::duration<double>(chrono::steady_clock::now() - analyzeStart).count();
+    cout<<"\rAnalyzed "<<mTracks.size()<<" tracks in "<<secs<<"s"<<endl;
+
+    char line[128];
+    cout<<"Track  Loudness (LUFS)  True Peak (dBTP)  Peak (dBFS)  Clipped  Skipped"<<endl;
+    for (size_t t = 0; t < results.size(); ++t) {
+        const auto& result = results[t];
+        const double skipped = result.length > 0 ? result.skipped.as_double()*100/result.length.as_double() : 0;
+        snprintf(line, sizeof(line), "%5d  %15.1f  %16.1f  %11.1f  %7llu  %6.0f%%", (int)t+1,
+            result.integrated, AudioGraph::LoudnessAnalyzer::toDb(result.truePeak), AudioGraph::LoudnessAnalyzer::toDb(result.samplePeak),
+            (unsigned long long)result.clips, skipped);
+        cout<<line<<(result.integrated <= AudioGraph::LoudnessAnalyzer::sFloorLufs ? " (silent)" : "")<<endl;
+    }
+}
+
 void PlaybackHandler::removeTrack(int trackNdx) {
     auto trackToBeRemoved = mTracks[trackNdx];
     cout<<"Are you sure you want to delete track # "<<trackNdx+1;
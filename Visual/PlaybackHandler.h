@@ -8,6 +8,7 @@
 
 #ifndef PLAYBACKHANDLER_H
 #define PLAYBACKHANDLER_H
+#include <optional>
 #include <portaudio.h>
 
 #include "../Audio/AudioData/SqliteSampleBlock.h"
@@ -31,6 +32,8 @@ class PlaybackHandler
     AudioIO *mAudioIO = AudioIO::Get();
 
     size_t mRate;
+    //level (dBFS) inputs have to stay under to be stored as silence, 0 is off
+    float mSilenceGateDb = 0.0f;
     size_t mNumInputs = 0;
     size_t mNumOutputs = 0;
 
@@ -71,7 +74,7 @@ public:
     void load(int = 0) override;
 
     //Playback
-    bool Play();
+    bool Play(std::optional<std::pair<double, double>> loopRange = std::nullopt);
     void stopPlayback();
     bool Record();
     void endRecording();
@@ -93,6 +96,10 @@ public:
     bool newTrack();
     void removeTrack(int trackNdx);
     bool changeTrackType(int trackNdx, AudioGraph::ChannelType type);
+    //a new mono track for every channel of the file
+    void importWav();
+    //loudness, true peak and clipping of every track over the whole recording
+    void analyzeLoudness();
     bool changeInChannels(int trackNdx, int channelNum);
     bool changeOutChannels(int trackNdx, int channelNum);
 
@@ -101,6 +108,8 @@ public:
     void changeAudioOutDev();
     void changeAudioAPI();
     void changeSRate();
+    //silence gating is lossy so its per show, saved with the rest of the settings
+    void changeSilenceGate();
 
     //CMDL IO stuff
     static void clrscr();
@@ -127,6 +136,10 @@ private:
     void viewSnapshots();
     bool goToSnapshot();
     void changeSnapshotsName();
+    //proposes snapshots at the start of every song from the silences between them
+    void findSongs();
+    //tells AudioIO which snapshots to keep warm for recalls
+    void warmSnapshots();
 
     std::string buildFileName();
     void createAudioTempDB();
@@ -141,6 +154,8 @@ private:
     void sRateDefault();
     void getSupportedRates (std::vector<size_t>& rates);
     void updateSRates();
+    void applySilenceGate();
+    int bindSilenceGate(sqlite3_stmt* stmt, int index) const;
 
     int inputTrackNum();
 };